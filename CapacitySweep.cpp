@@ -0,0 +1,393 @@
+#include "CapacitySweep.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <json.hpp>
+#include "LatencyHistogram.h"
+#include "PlatformTime.h"
+#include "StreamScheduler.h"
+#include "Telemetry.h"
+
+using json = nlohmann::json;
+
+static const uint64_t ns_per_sec = 1000000000ULL;
+// Streams settle (page faults, first connections) before the window
+static const uint64_t warmup_ns = ns_per_sec;
+// Share of its frame rate the slowest stream must keep, give or take the
+// one frame a window boundary can cut off
+static const double min_fps_ratio = 0.99;
+
+bool parse_sweep_formats(const char *list, std::vector<int> &formats)
+{
+	static const struct {
+		const char *name;
+		int format;
+	} names[] = {
+		{"uyvy", 1498831189}, {"uyva", 1096178005},
+		{"bgra", 1095911234}, {"rgba", 3},
+		{"rgbx", 4},          {"bgrx", 5},
+		{"p216", 909193808},  {"pa16", 909197648},
+		{"v210", V210_FORMAT},
+	};
+
+	formats.clear();
+	std::string item;
+	for (const char *p = list;; ++p) {
+		if (*p && *p != ',') {
+			item += (char)tolower((unsigned char)*p);
+			continue;
+		}
+		bool found = false;
+		for (const auto &entry : names) {
+			if (item == entry.name) {
+				formats.push_back(entry.format);
+				found = true;
+			}
+		}
+		if (!found)
+			return false;
+		item.clear();
+		if (!*p)
+			return true;
+	}
+}
+
+bool parse_sweep_resolutions(const char *list,
+			     std::vector<SweepResolution> &resolutions)
+{
+	resolutions.clear();
+	for (const char *p = list;;) {
+		char *end;
+		SweepResolution resolution;
+		resolution.xres = (int)strtol(p, &end, 10);
+		if (end == p || (*end != 'x' && *end != 'X'))
+			return false;
+		p = end + 1;
+		resolution.yres = (int)strtol(p, &end, 10);
+		if (end == p || resolution.xres <= 0 || resolution.yres <= 0)
+			return false;
+		resolutions.push_back(resolution);
+		if (!*end)
+			return true;
+		if (*end != ',')
+			return false;
+		p = end + 1;
+	}
+}
+
+// Sleep until deadline_ns (os_gettime_ns time). Returns false if exit_loop
+// was set first.
+static bool wait_until(uint64_t deadline_ns, const std::atomic<bool> &exit_loop)
+{
+	while (!exit_loop) {
+		const uint64_t now = os_gettime_ns();
+		if (now >= deadline_ns)
+			return true;
+		const uint64_t sleep_ns =
+			std::min<uint64_t>(deadline_ns - now, ns_per_sec / 10);
+		std::this_thread::sleep_for(std::chrono::nanoseconds(sleep_ns));
+	}
+	return false;
+}
+
+CapacitySweep::CapacitySweep(const SweepParams &params,
+			     const SendOptions &options,
+			     FrameCache &frame_cache, RenderPool &render_pool)
+	: params_(params),
+	  options_(options),
+	  frame_cache_(frame_cache),
+	  render_pool_(render_pool)
+{
+}
+
+CapacitySweep::Point CapacitySweep::describe(const StreamConfig &config)
+{
+	Point point = {};
+	char name[5];
+	point.config = config.name;
+	point.format = is_v210_format(config.format)
+			       ? "V210"
+			       : fourcc_name(get_format_enum(config.format),
+					     name);
+	point.xres = config.xres;
+	point.yres = config.yres;
+	point.frame_rate_N = config.frame_rate_N;
+	point.frame_rate_D = config.frame_rate_D;
+	return point;
+}
+
+CapacitySweep::Point CapacitySweep::measure(const StreamConfig &config,
+					    int count,
+					    const std::atomic<bool> &exit_loop)
+{
+	Point point = describe(config);
+	point.streams = count;
+
+	// Late and skipped frames come from the streams' telemetry slots,
+	// which are safe to read while the streams run
+	Telemetry telemetry;
+	if (!telemetry.create("sweep", (uint32_t)count)) {
+		std::cerr << "Could not create telemetry segment" << std::endl;
+		return point;
+	}
+
+	std::vector<std::unique_ptr<SendStream>> streams;
+	std::vector<SendStream *> stream_ptrs;
+	const int64_t start_time = (int64_t)os_gettime_ns();
+	for (int i = 0; i < count; ++i) {
+		StreamConfig stream_config = config;
+		stream_config.name = config.name + "_" + std::to_string(i + 1);
+		std::unique_ptr<SendStream> stream(
+			new SendStream(stream_config, options_));
+		if (!stream->init(frame_cache_, render_pool_, start_time,
+				  nullptr, &telemetry))
+			return point;
+		stream_ptrs.push_back(stream.get());
+		streams.push_back(std::move(stream));
+	}
+	point.started = true;
+
+	StreamScheduler scheduler(stream_ptrs, params_.workers,
+				  options_.pacing);
+	const uint64_t now = os_gettime_ns();
+	for (SendStream *stream : stream_ptrs)
+		stream->start_pacing(now);
+	std::atomic<bool> stop(false);
+	scheduler.start(stop);
+
+	// Counters of every stream and the timer histograms of all of them
+	// together, at the start and the end of the window
+	struct Sample {
+		uint64_t time_ns;
+		std::vector<TelemetryCounters> counters;
+		std::vector<uint64_t> render;
+		std::vector<uint64_t> send;
+	};
+	std::vector<uint64_t> counts(LatencyHistogram::N_BUCKETS);
+	auto take_sample = [&](Sample &sample) {
+		sample.time_ns = os_gettime_ns();
+		sample.counters.assign(count, TelemetryCounters());
+		sample.render.assign(LatencyHistogram::N_BUCKETS, 0);
+		sample.send.assign(LatencyHistogram::N_BUCKETS, 0);
+		for (int i = 0; i < count; ++i) {
+			Telemetry::read(*telemetry.slot((uint32_t)i),
+					sample.counters[i]);
+			stream_ptrs[i]->render_histogram().snapshot(
+				counts.data());
+			for (int b = 0; b < LatencyHistogram::N_BUCKETS; ++b)
+				sample.render[b] += counts[b];
+			stream_ptrs[i]->send_histogram().snapshot(
+				counts.data());
+			for (int b = 0; b < LatencyHistogram::N_BUCKETS; ++b)
+				sample.send[b] += counts[b];
+		}
+	};
+	Sample begin, end;
+	bool complete = wait_until(now + warmup_ns, exit_loop);
+	take_sample(begin);
+	complete = complete &&
+		   wait_until(begin.time_ns + (uint64_t)params_.window_s *
+						      ns_per_sec,
+			      exit_loop);
+	take_sample(end);
+
+	stop = true;
+	scheduler.join();
+	for (SendStream *stream : stream_ptrs)
+		stream->finish();
+
+	point.seconds = (double)(end.time_ns - begin.time_ns) / 1e9;
+	const double frame_rate =
+		(double)config.frame_rate_N / config.frame_rate_D;
+	point.fps_min = frame_rate;
+	const double min_frames =
+		min_fps_ratio * frame_rate * point.seconds - 1.0;
+	bool kept_rate = true;
+	for (int i = 0; i < count; ++i) {
+		const TelemetryCounters &a = begin.counters[i];
+		const TelemetryCounters &b = end.counters[i];
+		const uint64_t frames = b.frames - a.frames;
+		point.frames += frames;
+		point.late_frames += b.late_frames - a.late_frames;
+		point.skipped_frames += b.skipped_frames - a.skipped_frames;
+		if (point.seconds > 0)
+			point.fps_min = std::min(point.fps_min,
+						 frames / point.seconds);
+		kept_rate = kept_rate && frames >= min_frames;
+	}
+
+	auto percentile = [](const std::vector<uint64_t> &from,
+			     const std::vector<uint64_t> &to, double percent) {
+		std::vector<uint64_t> interval(to.size());
+		uint64_t total = 0;
+		for (size_t b = 0; b < to.size(); ++b) {
+			interval[b] = to[b] - from[b];
+			total += interval[b];
+		}
+		return total ? LatencyHistogram::percentile(interval.data(),
+							    total, percent)
+			     : 0;
+	};
+	point.render_p50_ns = percentile(begin.render, end.render, 50.0);
+	point.render_p99_ns = percentile(begin.render, end.render, 99.0);
+	point.send_p50_ns = percentile(begin.send, end.send, 50.0);
+	point.send_p99_ns = percentile(begin.send, end.send, 99.0);
+
+	point.sustained = complete && kept_rate && point.skipped_frames == 0 &&
+			  point.late_frames * 100.0 <=
+				  params_.max_late_percent * point.frames;
+	return point;
+}
+
+CapacitySweep::Capacity
+CapacitySweep::find_capacity(const StreamConfig &config,
+			     const std::atomic<bool> &exit_loop)
+{
+	Capacity capacity = {describe(config), 0, 0};
+	const int max_streams = std::max(params_.max_streams, 1);
+
+	auto try_count = [&](int count) {
+		const Point point = measure(config, count, exit_loop);
+		if (exit_loop)
+			return false; // cut short, not a measurement
+		printf("Sweep %s %s %dx%d %d/%d, %d streams: %.2f fps min, "
+		       "%llu late, %llu skipped: %s\n",
+		       point.config.c_str(), point.format.c_str(), point.xres,
+		       point.yres, point.frame_rate_N, point.frame_rate_D,
+		       count, point.fps_min,
+		       (unsigned long long)point.late_frames,
+		       (unsigned long long)point.skipped_frames,
+		       point.sustained ? "sustained" : "failed");
+		points_.push_back(point);
+		if (point.sustained)
+			capacity.max_streams = count;
+		else
+			capacity.first_failed = count;
+		return true;
+	};
+
+	// Double until a count fails, then bisect between the last sustained
+	// count and the first failed one
+	for (int count = 1; try_count(count) && !capacity.first_failed &&
+			    count < max_streams;)
+		count = std::min(count * 2, max_streams);
+	while (capacity.first_failed &&
+	       capacity.first_failed - capacity.max_streams > 1 &&
+	       try_count((capacity.max_streams + capacity.first_failed) / 2))
+		;
+	return capacity;
+}
+
+bool CapacitySweep::run(const std::vector<StreamConfig> &seeds,
+			const std::atomic<bool> &exit_loop)
+{
+	for (const StreamConfig &seed : seeds) {
+		std::vector<SweepResolution> resolutions = params_.resolutions;
+		if (resolutions.empty())
+			resolutions.push_back({seed.xres, seed.yres});
+		std::vector<int> formats = params_.formats;
+		if (formats.empty())
+			formats.push_back(seed.format);
+		for (const SweepResolution &resolution : resolutions) {
+			for (int format : formats) {
+				if (exit_loop)
+					break;
+				StreamConfig config = seed;
+				config.xres = resolution.xres;
+				config.yres = resolution.yres;
+				config.format = format;
+				capacities_.push_back(
+					find_capacity(config, exit_loop));
+			}
+		}
+	}
+
+	write(stdout);
+	if (params_.out_path.empty())
+		return true;
+	FILE *out = fopen(params_.out_path.c_str(), "w");
+	if (!out)
+		return false;
+	write(out);
+	fclose(out);
+	std::cout << "Capacity table: " << params_.out_path << std::endl;
+	return true;
+}
+
+void CapacitySweep::write(FILE *out) const
+{
+	if (params_.format == PerfFormat::Csv) {
+		fprintf(out,
+			"kind,config,format,resolution,frame_rate,streams,"
+			"seconds,fps_min,frames,late_frames,skipped_frames,"
+			"render_p50_ns,render_p99_ns,send_p50_ns,send_p99_ns,"
+			"sustained,first_failed\n");
+		for (const Point &p : points_)
+			fprintf(out,
+				"point,\"%s\",%s,%dx%d,%d/%d,%d,%.3f,%.3f,%llu,"
+				"%llu,%llu,%lld,%lld,%lld,%lld,%d,\n",
+				p.config.c_str(), p.format.c_str(), p.xres,
+				p.yres, p.frame_rate_N, p.frame_rate_D,
+				p.streams, p.seconds, p.fps_min,
+				(unsigned long long)p.frames,
+				(unsigned long long)p.late_frames,
+				(unsigned long long)p.skipped_frames,
+				(long long)p.render_p50_ns,
+				(long long)p.render_p99_ns,
+				(long long)p.send_p50_ns,
+				(long long)p.send_p99_ns, p.sustained ? 1 : 0);
+		for (const Capacity &c : capacities_)
+			fprintf(out,
+				"capacity,\"%s\",%s,%dx%d,%d/%d,%d,,,,,,,,,,,"
+				"%d\n",
+				c.seed.config.c_str(), c.seed.format.c_str(),
+				c.seed.xres, c.seed.yres, c.seed.frame_rate_N,
+				c.seed.frame_rate_D, c.max_streams,
+				c.first_failed);
+		fflush(out);
+		return;
+	}
+
+	auto describe_json = [](const Point &p) {
+		json entry;
+		entry["config"] = p.config;
+		entry["format"] = p.format;
+		entry["resolution"] =
+			std::to_string(p.xres) + "x" + std::to_string(p.yres);
+		entry["frame_rate"] = std::to_string(p.frame_rate_N) + "/" +
+				      std::to_string(p.frame_rate_D);
+		return entry;
+	};
+	json table;
+	table["window_s"] = params_.window_s;
+	table["points"] = json::array();
+	for (const Point &p : points_) {
+		json entry = describe_json(p);
+		entry["streams"] = p.streams;
+		entry["seconds"] = p.seconds;
+		entry["fps_min"] = p.fps_min;
+		entry["frames"] = p.frames;
+		entry["late_frames"] = p.late_frames;
+		entry["skipped_frames"] = p.skipped_frames;
+		entry["render_p50_ns"] = p.render_p50_ns;
+		entry["render_p99_ns"] = p.render_p99_ns;
+		entry["send_p50_ns"] = p.send_p50_ns;
+		entry["send_p99_ns"] = p.send_p99_ns;
+		entry["sustained"] = p.sustained;
+		table["points"].push_back(entry);
+	}
+	table["capacity"] = json::array();
+	for (const Capacity &c : capacities_) {
+		json entry = describe_json(c.seed);
+		entry["max_streams"] = c.max_streams;
+		entry["first_failed"] = c.first_failed;
+		table["capacity"].push_back(entry);
+	}
+	fprintf(out, "%s\n", table.dump(2).c_str());
+	fflush(out);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "FrameCache.h"
+#include "PerfReporter.h"
+#include "RenderPool.h"
+#include "SendStream.h"
+
+// Capacity benchmark: how many streams of each configuration one host can
+// keep on time.
+//
+// Each seed .cfg (optionally with its resolution and format replaced by each of
+// a list of resolutions and of formats) runs as 1, 2, 4, ... identical streams
+// until a count fails, then the counts between the last pass and the first
+// failure are bisected. A point runs for a warm-up second and then a fixed
+// window, in which the streams' render and send-blocking times, late and
+// skipped frames and frame rates are measured. A point is sustained when every
+// stream kept its frame rate, none skipped a frame and at most max_late_percent
+// of the frames were late; the highest sustained count is the configuration's
+// saturation point.
+
+struct SweepResolution {
+	int xres;
+	int yres;
+};
+
+struct SweepParams {
+	PerfFormat format = PerfFormat::Json;
+	int window_s = 10;    // measured seconds per point
+	int max_streams = 64; // highest stream count tried
+	double max_late_percent = 1.0; // of frames, for a sustained point
+	std::vector<int> formats; // .cfg format values, empty = the seed's
+	std::vector<SweepResolution> resolutions; // empty = the seed's
+	std::string out_path;     // table file, empty = stdout only
+	int workers = 0;          // StreamScheduler workers, 0 = automatic
+};
+
+// Parse a comma-separated list of uyvy, uyva, p216, pa16, v210, bgra,
+// bgrx, rgba and rgbx into .cfg format values. Returns false on an unknown
+// name.
+bool parse_sweep_formats(const char *list, std::vector<int> &formats);
+
+// Parse a comma-separated list of <xres>x<yres>, e.g. 1920x1080,3840x2160.
+// Returns false on anything else.
+bool parse_sweep_resolutions(const char *list,
+			     std::vector<SweepResolution> &resolutions);
+
+class CapacitySweep {
+public:
+	CapacitySweep(const SweepParams &params, const SendOptions &options,
+		      FrameCache &frame_cache, RenderPool &render_pool);
+
+	// Find the saturation point of every seed, then write the table.
+	// Stops early, with the points measured so far, when exit_loop is
+	// set. Returns false if the table file cannot be written.
+	bool run(const std::vector<StreamConfig> &seeds,
+		 const std::atomic<bool> &exit_loop);
+
+private:
+	struct Point {
+		std::string config; // seed name and format
+		std::string format;
+		int xres;
+		int yres;
+		int frame_rate_N;
+		int frame_rate_D;
+		int streams;
+		bool started; // every stream initialized
+		double seconds;
+		double fps_min; // of the slowest stream
+		uint64_t frames;
+		uint64_t late_frames;
+		uint64_t skipped_frames;
+		int64_t render_p50_ns;
+		int64_t render_p99_ns;
+		int64_t send_p50_ns;
+		int64_t send_p99_ns;
+		bool sustained;
+	};
+	struct Capacity {
+		Point seed;     // the configuration, with streams = 0
+		int max_streams; // highest sustained count, 0 if none
+		int first_failed; // lowest failed count, 0 if none failed
+	};
+
+	static Point describe(const StreamConfig &config);
+	Point measure(const StreamConfig &config, int streams,
+		      const std::atomic<bool> &exit_loop);
+	Capacity find_capacity(const StreamConfig &config,
+			       const std::atomic<bool> &exit_loop);
+	void write(FILE *out) const;
+
+	const SweepParams params_;
+	const SendOptions options_;
+	FrameCache &frame_cache_;
+	RenderPool &render_pool_;
+	std::vector<Point> points_;
+	std::vector<Capacity> capacities_;
+};
@@ -0,0 +1,124 @@
+#include "ClipFile.h"
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(ClipHeader) <= ClipFile::HEADER_SIZE,
+	      "header fits its page");
+
+ClipFile::ClipFile()
+	: header_(),
+	  p_map_(nullptr),
+	  map_size_(0),
+#ifdef _WIN32
+	  file_(INVALID_HANDLE_VALUE),
+	  mapping_(NULL)
+#else
+	  fd_(-1)
+#endif
+{
+}
+
+ClipFile::~ClipFile()
+{
+#ifdef _WIN32
+	if (p_map_)
+		UnmapViewOfFile(p_map_);
+	if (mapping_)
+		CloseHandle(mapping_);
+	if (file_ != INVALID_HANDLE_VALUE)
+		CloseHandle(file_);
+#else
+	if (p_map_)
+		munmap((void *)p_map_, map_size_);
+	if (fd_ >= 0)
+		::close(fd_);
+#endif
+}
+
+std::shared_ptr<const ClipFile> ClipFile::open(const std::string &path)
+{
+	std::shared_ptr<ClipFile> clip(new ClipFile());
+	clip->path_ = path;
+
+	void *p_map = nullptr;
+#ifdef _WIN32
+	// Frames are read front to back; tell the cache manager to read ahead
+	clip->file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+				  NULL, OPEN_EXISTING,
+				  FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (clip->file_ == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Could not open clip: " + path);
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(clip->file_, &size))
+		clip->map_size_ = (size_t)size.QuadPart;
+	if (clip->map_size_ >= HEADER_SIZE) {
+		clip->mapping_ = CreateFileMappingA(clip->file_, NULL,
+						    PAGE_READONLY, 0, 0, NULL);
+		if (clip->mapping_)
+			p_map = MapViewOfFile(clip->mapping_, FILE_MAP_READ, 0,
+					      0, 0);
+	}
+#else
+	clip->fd_ = ::open(path.c_str(), O_RDONLY);
+	if (clip->fd_ < 0)
+		throw std::runtime_error("Could not open clip: " + path);
+	struct stat st;
+	if (fstat(clip->fd_, &st) == 0)
+		clip->map_size_ = (size_t)st.st_size;
+	if (clip->map_size_ >= HEADER_SIZE) {
+		p_map = mmap(NULL, clip->map_size_, PROT_READ, MAP_SHARED,
+			     clip->fd_, 0);
+		if (p_map == MAP_FAILED)
+			p_map = nullptr;
+		else
+			posix_madvise(p_map, clip->map_size_,
+				      POSIX_MADV_SEQUENTIAL);
+	}
+#endif
+	if (!p_map)
+		throw std::runtime_error("Could not map clip: " + path);
+	clip->p_map_ = (const uint8_t *)p_map;
+
+	ClipHeader &header = clip->header_;
+	memcpy(&header, p_map, sizeof(header));
+	if (memcmp(header.magic, "SYNCCLP1", 8) != 0 ||
+	    header.header_size != HEADER_SIZE)
+		throw std::runtime_error("Not a clip file: " + path);
+	if (header.xres <= 0 || header.yres <= 0 || header.frame_count == 0 ||
+	    header.frame_size == 0 || header.frame_rate_N <= 0 ||
+	    header.frame_rate_D <= 0)
+		throw std::runtime_error("Bad clip header: " + path);
+	if (header.frame_count >
+	    (clip->map_size_ - HEADER_SIZE) / header.frame_size)
+		throw std::runtime_error("Clip is truncated: " + path);
+	return clip;
+}
+
+void ClipFile::prefetch(uint64_t n) const
+{
+	if (n >= header_.frame_count)
+		return;
+#ifdef _WIN32
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = (PVOID)frame(n);
+	range.NumberOfBytes = (SIZE_T)header_.frame_size;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	// posix_madvise wants a page-aligned start
+	static const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	const uintptr_t start = (uintptr_t)frame(n);
+	const uintptr_t aligned = start & ~(page - 1);
+	posix_madvise((void *)aligned,
+		      (size_t)(start - aligned + header_.frame_size),
+		      POSIX_MADV_WILLNEED);
+#endif
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Memory-mapped raw clip that streams play in a loop instead of solid
+// frames.
+//
+// The file is a 4 KB ClipHeader followed by frame_count frames of
+// frame_size bytes each, already in the stream's FourCC and layout (see
+// FrameLayout; V210 streams take P216 clips). A file sink recording of a
+// stream with this header in front of it is a clip for that stream. Frames
+// are sent straight out of the mapping, so playing a clip costs neither a
+// decode nor a copy, and the OS page cache reads ahead through the file.
+
+#pragma pack(push, 1)
+struct ClipHeader {
+	char magic[8]; // "SYNCCLP1"
+	uint32_t header_size;
+	uint32_t fourcc;
+	int32_t xres;
+	int32_t yres;
+	int32_t frame_rate_N;
+	int32_t frame_rate_D;
+	uint64_t frame_count;
+	uint64_t frame_size; // bytes from one frame to the next
+};
+#pragma pack(pop)
+
+class ClipFile {
+public:
+	static constexpr size_t HEADER_SIZE = 4096;
+
+	~ClipFile();
+
+	ClipFile(const ClipFile &) = delete;
+	ClipFile &operator=(const ClipFile &) = delete;
+
+	// Map path read-only. Throws std::runtime_error if it cannot be
+	// mapped or its header does not describe the file.
+	static std::shared_ptr<const ClipFile> open(const std::string &path);
+
+	const std::string &path() const { return path_; }
+	uint32_t fourcc() const { return header_.fourcc; }
+	int xres() const { return header_.xres; }
+	int yres() const { return header_.yres; }
+	int frame_rate_N() const { return header_.frame_rate_N; }
+	int frame_rate_D() const { return header_.frame_rate_D; }
+	uint64_t frame_count() const { return header_.frame_count; }
+	size_t frame_size() const { return (size_t)header_.frame_size; }
+
+	// Frame n (< frame_count) in the mapping. The first read of a page
+	// the OS has not read ahead blocks on the disk.
+	const uint8_t *frame(uint64_t n) const
+	{
+		return p_map_ + HEADER_SIZE + (size_t)n * header_.frame_size;
+	}
+	// Ask the OS to start reading frame n, e.g. the first frame when the
+	// loop is about to wrap. Does not block.
+	void prefetch(uint64_t n) const;
+
+private:
+	ClipFile();
+
+	std::string path_;
+	ClipHeader header_;
+	const uint8_t *p_map_;
+	size_t map_size_;
+#ifdef _WIN32
+	void *file_;
+	void *mapping_;
+#else
+	int fd_;
+#endif
+};
@@ -0,0 +1,170 @@
+// FillBench.cpp : Measures the SyncTestSend fill kernels in GB/s for every
+// instruction set the CPU supports, using the SyncTestSend .cfg files as the
+// set of resolutions and formats.
+//
+// Usage: FillBench [-allformats] [-seconds=<s>] [cfg file or folder ...]
+// Without arguments every *.cfg file in the current folder is used.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "../FillKernels.h"
+#include "../FrameLayout.h"
+
+using json = nlohmann::json;
+
+struct BenchConfig {
+	std::string name;
+	int xres;
+	int yres;
+	int format;
+};
+
+static bool read_config(const std::filesystem::path &path, BenchConfig &cfg)
+{
+	try {
+		std::ifstream file(path);
+		if (!file.is_open())
+			return false;
+		json config;
+		file >> config;
+
+		// Same defaults as SyncTestSend
+		cfg.name = path.stem().string();
+		cfg.xres = config.value("xres", 1920);
+		cfg.yres = config.value("yres", 1080);
+		cfg.format = config.value("format", 1498831189);
+		return true;
+	} catch (const std::exception &e) {
+		std::cerr << "Error reading config file " << path.string()
+			  << ": " << e.what() << std::endl;
+		return false;
+	}
+}
+
+// Fill the frame repeatedly for about `seconds` and return GB/s
+static double measure(const FrameLayout &layout, uint8_t *p_data,
+		      double seconds)
+{
+	using clock = std::chrono::steady_clock;
+
+	// Warm up: first touch and a couple of passes
+	for (int i = 0; i < 2; ++i)
+		fill_frame(layout, p_data, 0x80EB80EBu + i);
+
+	uint64_t iterations = 0;
+	const auto t0 = clock::now();
+	auto t1 = t0;
+	do {
+		fill_frame(layout, p_data, (uint32_t)iterations);
+		++iterations;
+		t1 = clock::now();
+	} while (std::chrono::duration<double>(t1 - t0).count() < seconds);
+
+	const double elapsed = std::chrono::duration<double>(t1 - t0).count();
+	return (double)layout.total_size * (double)iterations / elapsed / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+	bool all_formats = false;
+	double seconds = 0.5;
+	std::vector<std::filesystem::path> inputs;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-allformats") == 0) {
+			all_formats = true;
+		} else if (strncmp(argv[i], "-seconds=", 9) == 0) {
+			seconds = std::atof(argv[i] + 9);
+		} else {
+			inputs.push_back(argv[i]);
+		}
+	}
+	if (inputs.empty())
+		inputs.push_back(".");
+
+	std::vector<BenchConfig> configs;
+	for (const auto &input : inputs) {
+		std::vector<std::filesystem::path> files;
+		if (std::filesystem::is_directory(input)) {
+			for (const auto &entry :
+			     std::filesystem::directory_iterator(input)) {
+				if (entry.path().extension() == ".cfg")
+					files.push_back(entry.path());
+			}
+			std::sort(files.begin(), files.end());
+		} else {
+			files.push_back(input);
+		}
+		for (const auto &file : files) {
+			BenchConfig cfg;
+			if (read_config(file, cfg))
+				configs.push_back(cfg);
+		}
+	}
+	if (configs.empty()) {
+		std::cerr << "No .cfg files found" << std::endl;
+		return 1;
+	}
+
+	const NDIlib_FourCC_video_type_e all[] = {
+		NDIlib_FourCC_type_UYVY, NDIlib_FourCC_type_UYVA,
+		NDIlib_FourCC_type_BGRA, NDIlib_FourCC_type_BGRX,
+		NDIlib_FourCC_type_RGBA, NDIlib_FourCC_type_RGBX,
+		NDIlib_FourCC_type_P216, NDIlib_FourCC_type_PA16};
+
+	const FillIsa best = fill_kernels_detect();
+	std::cout << "CPU supports: " << fill_isa_name(best) << std::endl;
+	std::cout << "Non-temporal stores above " << FILL_STREAM_THRESHOLD
+		  << " bytes" << std::endl;
+	printf("%-20s %-6s %-11s %10s", "config", "fourcc", "resolution",
+	       "MB/frame");
+	for (int isa = 0; isa <= (int)best; ++isa)
+		printf(" %9s", fill_isa_name((FillIsa)isa));
+	printf("   (GB/s)\n");
+
+	for (const auto &cfg : configs) {
+		std::vector<NDIlib_FourCC_video_type_e> fourccs;
+		if (all_formats)
+			fourccs.assign(std::begin(all), std::end(all));
+		else
+			fourccs.push_back(get_format_enum(cfg.format));
+
+		for (auto fourcc : fourccs) {
+			const FrameLayout layout =
+				get_frame_layout(fourcc, cfg.xres, cfg.yres);
+			uint8_t *p_data = (uint8_t *)malloc(layout.total_size);
+			if (!p_data) {
+				std::cerr << "Failed to allocate "
+					  << layout.total_size << " bytes"
+					  << std::endl;
+				return 1;
+			}
+
+			char name[5];
+			char resolution[32];
+			snprintf(resolution, sizeof(resolution), "%dx%d",
+				 cfg.xres, cfg.yres);
+			printf("%-20s %-6s %-11s %10.2f", cfg.name.c_str(),
+			       fourcc_name(fourcc, name), resolution,
+			       (double)layout.total_size / (1024.0 * 1024.0));
+			for (int isa = 0; isa <= (int)best; ++isa) {
+				fill_kernels_init((FillIsa)isa);
+				printf(" %9.2f",
+				       measure(layout, p_data, seconds));
+				fflush(stdout);
+			}
+			printf("\n");
+			free(p_data);
+		}
+	}
+	return 0;
+}
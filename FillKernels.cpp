@@ -0,0 +1,599 @@
+#include "FillKernels.h"
+#include <algorithm>
+#include "PatternRenderer.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+	defined(__i386__)
+#define FILL_HAVE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define FILL_HAVE_X86 0
+#endif
+
+// MSVC lets any function use any intrinsic; GCC and Clang need the target
+// enabled per function so the rest of the file still runs on older CPUs.
+#if defined(_MSC_VER) || !FILL_HAVE_X86
+#define FILL_TARGET(isa)
+#else
+#define FILL_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+typedef void (*fill_fn)(uint8_t *dst, size_t bytes, uint32_t pattern);
+typedef void (*pack_fn)(const uint16_t *y, const uint16_t *uv,
+			uint32_t *dst, int xres);
+typedef void (*ycbcr_fn)(const uint32_t *rgbx, int16_t *y, int16_t *cb,
+			 int16_t *cr, int x, int n, const YcbcrCoeffs &coeffs);
+
+static inline uint32_t rotate_pattern(uint32_t pattern, size_t bytes)
+{
+	// Pattern seen from a pointer that is `bytes` past the pattern origin
+	const unsigned shift = (unsigned)(bytes & 3) * 8;
+	return shift ? (pattern >> shift) | (pattern << (32 - shift))
+		     : pattern;
+}
+
+static void fill_scalar(uint8_t *dst, size_t bytes, uint32_t pattern)
+{
+	size_t i = 0;
+	// Byte-wise until dst is 8-byte aligned
+	while (i < bytes && ((uintptr_t)(dst + i) & 7)) {
+		dst[i] = (uint8_t)(pattern >> ((i & 3) * 8));
+		++i;
+	}
+	const uint32_t p = rotate_pattern(pattern, i);
+	const uint64_t p64 = (uint64_t)p | ((uint64_t)p << 32);
+	for (; i + 8 <= bytes; i += 8)
+		memcpy(dst + i, &p64, 8);
+	for (size_t k = 0; i < bytes; ++i, ++k)
+		dst[i] = (uint8_t)(p >> ((k & 3) * 8));
+}
+
+// One V210 row: every 6 pixels become 4 little-endian words of three 10-bit
+// fields, Cb0 Y0 Cr0 | Y1 Cb1 Y2 | Cr1 Y3 Cb2 | Y4 Cr2 Y5. Starts at pixel
+// x, which is a multiple of 6; pixels past xres are packed as 0.
+static void pack_v210_scalar(const uint16_t *y, const uint16_t *uv,
+			     uint32_t *dst, int x, int xres)
+{
+	for (; x < xres; x += 6) {
+		uint32_t s[12]; // Cb0 Y0 Cr0 Y1 Cb1 Y2 Cr1 Y3 Cb2 Y4 Cr2 Y5
+		for (int i = 0; i < 6; ++i) {
+			const bool in = x + i < xres;
+			s[2 * i] = in ? uv[x + i] >> 6 : 0;
+			s[2 * i + 1] = in ? y[x + i] >> 6 : 0;
+		}
+		*dst++ = s[0] | (s[1] << 10) | (s[2] << 20);
+		*dst++ = s[3] | (s[4] << 10) | (s[5] << 20);
+		*dst++ = s[6] | (s[7] << 10) | (s[8] << 20);
+		*dst++ = s[9] | (s[10] << 10) | (s[11] << 20);
+	}
+}
+
+static void pack_row_scalar(const uint16_t *y, const uint16_t *uv,
+			    uint32_t *dst, int xres)
+{
+	pack_v210_scalar(y, uv, dst, 0, xres);
+}
+
+// Pixels [x, n) of rgb_to_ycbcr12
+static void ycbcr_scalar(const uint32_t *rgbx, int16_t *y, int16_t *cb,
+			 int16_t *cr, int x, int n, const YcbcrCoeffs &coeffs)
+{
+	const int round = 1 << 9;
+	for (; x < n; ++x) {
+		const int r = rgbx[x] & 0xFF;
+		const int g = (rgbx[x] >> 8) & 0xFF;
+		const int b = (rgbx[x] >> 16) & 0xFF;
+		y[x] = (int16_t)(((64 << 12) + round + coeffs.y[0] * r +
+				  coeffs.y[1] * g + coeffs.y[2] * b) >>
+				 10);
+		cb[x] = (int16_t)(((512 << 12) + round + coeffs.cb[0] * r +
+				   coeffs.cb[1] * g + coeffs.cb[2] * b) >>
+				  10);
+		cr[x] = (int16_t)(((512 << 12) + round + coeffs.cr[0] * r +
+				   coeffs.cr[1] * g + coeffs.cr[2] * b) >>
+				  10);
+	}
+}
+
+#if FILL_HAVE_X86
+
+// Each SIMD kernel writes a scalar head up to vector alignment, then aligned
+// vectors unrolled 4x, then a scalar tail. The store flavour is a template
+// flag so the temporal and streaming loops share one body.
+
+template<bool Stream>
+FILL_TARGET("sse2")
+static void fill_sse2_impl(uint8_t *dst, size_t bytes, uint32_t pattern)
+{
+	size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+	if (head > bytes)
+		head = bytes;
+	fill_scalar(dst, head, pattern);
+	dst += head;
+	bytes -= head;
+
+	const __m128i v = _mm_set1_epi32((int)rotate_pattern(pattern, head));
+	size_t i = 0;
+	for (; i + 64 <= bytes; i += 64) {
+		__m128i *p = (__m128i *)(dst + i);
+		if (Stream) {
+			_mm_stream_si128(p + 0, v);
+			_mm_stream_si128(p + 1, v);
+			_mm_stream_si128(p + 2, v);
+			_mm_stream_si128(p + 3, v);
+		} else {
+			_mm_store_si128(p + 0, v);
+			_mm_store_si128(p + 1, v);
+			_mm_store_si128(p + 2, v);
+			_mm_store_si128(p + 3, v);
+		}
+	}
+	for (; i + 16 <= bytes; i += 16) {
+		if (Stream)
+			_mm_stream_si128((__m128i *)(dst + i), v);
+		else
+			_mm_store_si128((__m128i *)(dst + i), v);
+	}
+	if (Stream)
+		_mm_sfence();
+	fill_scalar(dst + i, bytes - i, rotate_pattern(pattern, head + i));
+}
+
+template<bool Stream>
+FILL_TARGET("avx2")
+static void fill_avx2_impl(uint8_t *dst, size_t bytes, uint32_t pattern)
+{
+	size_t head = (32 - ((uintptr_t)dst & 31)) & 31;
+	if (head > bytes)
+		head = bytes;
+	fill_scalar(dst, head, pattern);
+	dst += head;
+	bytes -= head;
+
+	const __m256i v =
+		_mm256_set1_epi32((int)rotate_pattern(pattern, head));
+	size_t i = 0;
+	for (; i + 128 <= bytes; i += 128) {
+		__m256i *p = (__m256i *)(dst + i);
+		if (Stream) {
+			_mm256_stream_si256(p + 0, v);
+			_mm256_stream_si256(p + 1, v);
+			_mm256_stream_si256(p + 2, v);
+			_mm256_stream_si256(p + 3, v);
+		} else {
+			_mm256_store_si256(p + 0, v);
+			_mm256_store_si256(p + 1, v);
+			_mm256_store_si256(p + 2, v);
+			_mm256_store_si256(p + 3, v);
+		}
+	}
+	for (; i + 32 <= bytes; i += 32) {
+		if (Stream)
+			_mm256_stream_si256((__m256i *)(dst + i), v);
+		else
+			_mm256_store_si256((__m256i *)(dst + i), v);
+	}
+	if (Stream)
+		_mm_sfence();
+	_mm256_zeroupper();
+	fill_scalar(dst + i, bytes - i, rotate_pattern(pattern, head + i));
+}
+
+template<bool Stream>
+FILL_TARGET("avx512f")
+static void fill_avx512_impl(uint8_t *dst, size_t bytes, uint32_t pattern)
+{
+	size_t head = (64 - ((uintptr_t)dst & 63)) & 63;
+	if (head > bytes)
+		head = bytes;
+	fill_scalar(dst, head, pattern);
+	dst += head;
+	bytes -= head;
+
+	const __m512i v =
+		_mm512_set1_epi32((int)rotate_pattern(pattern, head));
+	size_t i = 0;
+	for (; i + 256 <= bytes; i += 256) {
+		uint8_t *p = dst + i;
+		if (Stream) {
+			_mm512_stream_si512((__m512i *)(p + 0), v);
+			_mm512_stream_si512((__m512i *)(p + 64), v);
+			_mm512_stream_si512((__m512i *)(p + 128), v);
+			_mm512_stream_si512((__m512i *)(p + 192), v);
+		} else {
+			_mm512_store_si512(p + 0, v);
+			_mm512_store_si512(p + 64, v);
+			_mm512_store_si512(p + 128, v);
+			_mm512_store_si512(p + 192, v);
+		}
+	}
+	for (; i + 64 <= bytes; i += 64) {
+		if (Stream)
+			_mm512_stream_si512((__m512i *)(dst + i), v);
+		else
+			_mm512_store_si512(dst + i, v);
+	}
+	if (Stream)
+		_mm_sfence();
+	_mm256_zeroupper();
+	fill_scalar(dst + i, bytes - i, rotate_pattern(pattern, head + i));
+}
+
+static void fill_sse2(uint8_t *d, size_t n, uint32_t p)
+{
+	fill_sse2_impl<false>(d, n, p);
+}
+static void stream_sse2(uint8_t *d, size_t n, uint32_t p)
+{
+	fill_sse2_impl<true>(d, n, p);
+}
+static void fill_avx2(uint8_t *d, size_t n, uint32_t p)
+{
+	fill_avx2_impl<false>(d, n, p);
+}
+static void stream_avx2(uint8_t *d, size_t n, uint32_t p)
+{
+	fill_avx2_impl<true>(d, n, p);
+}
+static void fill_avx512(uint8_t *d, size_t n, uint32_t p)
+{
+	fill_avx512_impl<false>(d, n, p);
+}
+static void stream_avx512(uint8_t *d, size_t n, uint32_t p)
+{
+	fill_avx512_impl<true>(d, n, p);
+}
+
+// 6 pixels per iteration: three shuffles gather the low, middle and high
+// 10-bit field of each output word from 8 Y and 8 CbCr samples. The vector
+// loop stops while the 16-byte loads still fit in the row.
+FILL_TARGET("ssse3")
+static void pack_row_ssse3(const uint16_t *y, const uint16_t *uv,
+			   uint32_t *dst, int xres)
+{
+	const char z = (char)0x80;
+	const __m128i low_c = _mm_setr_epi8(0, 1, z, z, z, z, z, z, 6, 7, z, z,
+					    z, z, z, z);
+	const __m128i low_y = _mm_setr_epi8(z, z, z, z, 2, 3, z, z, z, z, z, z,
+					    8, 9, z, z);
+	const __m128i mid_y = _mm_setr_epi8(0, 1, z, z, z, z, z, z, 6, 7, z, z,
+					    z, z, z, z);
+	const __m128i mid_c = _mm_setr_epi8(z, z, z, z, 4, 5, z, z, z, z, z, z,
+					    10, 11, z, z);
+	const __m128i high_c = _mm_setr_epi8(2, 3, z, z, z, z, z, z, 8, 9, z,
+					     z, z, z, z, z);
+	const __m128i high_y = _mm_setr_epi8(z, z, z, z, 4, 5, z, z, z, z, z,
+					     z, 10, 11, z, z);
+
+	int x = 0;
+	for (; x + 8 <= xres; x += 6, dst += 4) {
+		const __m128i vy = _mm_loadu_si128((const __m128i *)(y + x));
+		const __m128i vc = _mm_loadu_si128((const __m128i *)(uv + x));
+		const __m128i low = _mm_or_si128(_mm_shuffle_epi8(vc, low_c),
+						 _mm_shuffle_epi8(vy, low_y));
+		const __m128i mid = _mm_or_si128(_mm_shuffle_epi8(vy, mid_y),
+						 _mm_shuffle_epi8(vc, mid_c));
+		const __m128i high = _mm_or_si128(_mm_shuffle_epi8(vc, high_c),
+						  _mm_shuffle_epi8(vy, high_y));
+		const __m128i word = _mm_or_si128(
+			_mm_or_si128(_mm_srli_epi32(low, 6),
+				     _mm_slli_epi32(_mm_srli_epi32(mid, 6), 10)),
+			_mm_slli_epi32(_mm_srli_epi32(high, 6), 20));
+		_mm_storeu_si128((__m128i *)dst, word);
+	}
+	pack_v210_scalar(y, uv, dst, x, xres);
+}
+
+// The dot products of 4 RGBX pixels with (k0, k1, k2, 0): the pixels widen
+// to 16-bit R G B X, one multiply-add makes R*k0 + G*k1 and B*k2 per pixel,
+// and the two halves are added and gathered into 4 lanes.
+FILL_TARGET("sse2")
+static inline __m128i dot_rgbx_sse2(__m128i lo, __m128i hi, __m128i k,
+				    __m128i offset)
+{
+	__m128i a = _mm_madd_epi16(lo, k);
+	__m128i b = _mm_madd_epi16(hi, k);
+	a = _mm_add_epi32(a, _mm_srli_epi64(a, 32));
+	b = _mm_add_epi32(b, _mm_srli_epi64(b, 32));
+	a = _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0));
+	b = _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0));
+	return _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi64(a, b), offset),
+			      10);
+}
+
+// 8 pixels per iteration, one 4-pixel dot product per output and half
+FILL_TARGET("sse2")
+static void ycbcr_sse2(const uint32_t *rgbx, int16_t *y, int16_t *cb,
+		       int16_t *cr, int x, int n, const YcbcrCoeffs &coeffs)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ky = _mm_setr_epi16(coeffs.y[0], coeffs.y[1],
+					  coeffs.y[2], 0, coeffs.y[0],
+					  coeffs.y[1], coeffs.y[2], 0);
+	const __m128i kcb = _mm_setr_epi16(coeffs.cb[0], coeffs.cb[1],
+					   coeffs.cb[2], 0, coeffs.cb[0],
+					   coeffs.cb[1], coeffs.cb[2], 0);
+	const __m128i kcr = _mm_setr_epi16(coeffs.cr[0], coeffs.cr[1],
+					   coeffs.cr[2], 0, coeffs.cr[0],
+					   coeffs.cr[1], coeffs.cr[2], 0);
+	const __m128i y_offset = _mm_set1_epi32((64 << 12) + (1 << 9));
+	const __m128i c_offset = _mm_set1_epi32((512 << 12) + (1 << 9));
+
+	for (; x + 8 <= n; x += 8) {
+		const __m128i p0 = _mm_loadu_si128((const __m128i *)(rgbx + x));
+		const __m128i p1 =
+			_mm_loadu_si128((const __m128i *)(rgbx + x + 4));
+		const __m128i lo0 = _mm_unpacklo_epi8(p0, zero);
+		const __m128i hi0 = _mm_unpackhi_epi8(p0, zero);
+		const __m128i lo1 = _mm_unpacklo_epi8(p1, zero);
+		const __m128i hi1 = _mm_unpackhi_epi8(p1, zero);
+		_mm_storeu_si128(
+			(__m128i *)(y + x),
+			_mm_packs_epi32(
+				dot_rgbx_sse2(lo0, hi0, ky, y_offset),
+				dot_rgbx_sse2(lo1, hi1, ky, y_offset)));
+		_mm_storeu_si128(
+			(__m128i *)(cb + x),
+			_mm_packs_epi32(
+				dot_rgbx_sse2(lo0, hi0, kcb, c_offset),
+				dot_rgbx_sse2(lo1, hi1, kcb, c_offset)));
+		_mm_storeu_si128(
+			(__m128i *)(cr + x),
+			_mm_packs_epi32(
+				dot_rgbx_sse2(lo0, hi0, kcr, c_offset),
+				dot_rgbx_sse2(lo1, hi1, kcr, c_offset)));
+	}
+	ycbcr_scalar(rgbx, y, cb, cr, x, n, coeffs);
+}
+
+static void cpuid(int leaf, int subleaf, unsigned regs[4])
+{
+#ifdef _MSC_VER
+	int r[4];
+	__cpuidex(r, leaf, subleaf);
+	for (int i = 0; i < 4; ++i)
+		regs[i] = (unsigned)r[i];
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t read_xcr0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned lo, hi;
+	__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+#endif // FILL_HAVE_X86
+
+FillIsa fill_kernels_detect()
+{
+#if FILL_HAVE_X86
+	unsigned r[4];
+	cpuid(0, 0, r);
+	const unsigned max_leaf = r[0];
+
+	cpuid(1, 0, r);
+	if (!(r[3] & (1u << 26))) // SSE2
+		return FillIsa::Scalar;
+
+	// AVX state must be enabled by the OS (OSXSAVE + XCR0 YMM bits)
+	const bool osxsave = (r[2] & (1u << 27)) != 0;
+	if (!osxsave || max_leaf < 7)
+		return FillIsa::SSE2;
+	const uint64_t xcr0 = read_xcr0();
+	if ((xcr0 & 0x6) != 0x6)
+		return FillIsa::SSE2;
+
+	cpuid(7, 0, r);
+	const bool avx2 = (r[1] & (1u << 5)) != 0;
+	const bool avx512f = (r[1] & (1u << 16)) != 0;
+	if (avx512f && (xcr0 & 0xE6) == 0xE6) // opmask + ZMM state
+		return FillIsa::AVX512;
+	if (avx2)
+		return FillIsa::AVX2;
+	return FillIsa::SSE2;
+#else
+	return FillIsa::Scalar;
+#endif
+}
+
+static FillIsa selected_isa = FillIsa::Scalar;
+// Scalar until fill_kernels_init() runs. Only that writes these, before any
+// thread renders, so the render threads read them without synchronization.
+static fill_fn fill_impl = fill_scalar;
+static fill_fn stream_impl = fill_scalar;
+static pack_fn pack_impl = pack_row_scalar;
+static ycbcr_fn ycbcr_impl = ycbcr_scalar;
+
+void fill_kernels_init(FillIsa max_isa)
+{
+	FillIsa isa = fill_kernels_detect();
+	if (isa > max_isa)
+		isa = max_isa;
+
+	selected_isa = isa;
+	switch (isa) {
+#if FILL_HAVE_X86
+	case FillIsa::AVX512:
+		fill_impl = fill_avx512;
+		stream_impl = stream_avx512;
+		pack_impl = pack_row_ssse3;
+		ycbcr_impl = ycbcr_sse2;
+		break;
+	case FillIsa::AVX2:
+		fill_impl = fill_avx2;
+		stream_impl = stream_avx2;
+		pack_impl = pack_row_ssse3;
+		ycbcr_impl = ycbcr_sse2;
+		break;
+	case FillIsa::SSE2:
+		fill_impl = fill_sse2;
+		stream_impl = stream_sse2;
+		pack_impl = pack_row_scalar;
+		ycbcr_impl = ycbcr_sse2;
+		break;
+#endif
+	default:
+		selected_isa = FillIsa::Scalar;
+		fill_impl = fill_scalar;
+		stream_impl = fill_scalar;
+		pack_impl = pack_row_scalar;
+		ycbcr_impl = ycbcr_scalar;
+		break;
+	}
+}
+
+FillIsa fill_kernels_isa()
+{
+	return selected_isa;
+}
+
+const char *fill_isa_name(FillIsa isa)
+{
+	switch (isa) {
+	case FillIsa::SSE2:
+		return "SSE2";
+	case FillIsa::AVX2:
+		return "AVX2";
+	case FillIsa::AVX512:
+		return "AVX-512";
+	case FillIsa::Scalar:
+	default:
+		return "Scalar";
+	}
+}
+
+void fill_pattern32(uint8_t *dst, size_t bytes, uint32_t pattern)
+{
+	fill_impl(dst, bytes, pattern);
+}
+
+void fill_pattern32_stream(uint8_t *dst, size_t bytes, uint32_t pattern)
+{
+	stream_impl(dst, bytes, pattern);
+}
+
+void fill_frame(const FrameLayout &layout, uint8_t *p_data, uint32_t color)
+{
+	fill_frame_rows(layout, p_data, color, 0, layout.yres);
+}
+
+void fill_frame_rows(const FrameLayout &layout, uint8_t *p_data,
+		     uint32_t color, int first_row, int last_row)
+{
+	PatternParams params = {color, 0, 0, layout.xres, layout.yres};
+	select_pattern_renderer(layout.fourcc, PatternType::Solid)(
+		layout, p_data, params, first_row, last_row);
+}
+
+void fill_rect(const FrameLayout &layout, uint8_t *p_data, int x, int y,
+	       int w, int h, uint32_t color)
+{
+	PatternParams params = {color, x, y, w, h};
+	select_pattern_renderer(layout.fourcc, PatternType::Box)(
+		layout, p_data, params, 0, layout.yres);
+}
+
+// Every plane of layout as (offset, bytes per pixel); P216's Y and CbCr
+// planes both have 2 bytes per pixel. Returns the number of planes.
+static int frame_planes(const FrameLayout &layout, size_t (&offsets)[3],
+			size_t (&sizes)[3])
+{
+	const size_t pixels = (size_t)layout.xres * layout.yres;
+	const bool semi_planar16 = layout.fourcc == NDIlib_FourCC_type_P216 ||
+				   layout.fourcc == NDIlib_FourCC_type_PA16;
+	offsets[0] = 0;
+	sizes[0] = layout.line_stride / layout.xres;
+	int planes = 1;
+	if (semi_planar16) {
+		offsets[planes] = pixels * 2;
+		sizes[planes++] = 2;
+	}
+	if (layout.alpha_plane_size) {
+		offsets[planes] = layout.plane1_size;
+		sizes[planes++] = layout.alpha_plane_size / pixels;
+	}
+	return planes;
+}
+
+void copy_rect(const FrameLayout &layout, uint8_t *dst, const uint8_t *src,
+	       int x, int y, int w, int h)
+{
+	// 4:2:2 formats copy whole chroma pairs
+	const bool rgb = layout.line_stride == (size_t)layout.xres * 4;
+	const int align = rgb ? 1 : 2;
+	const int x0 = std::max(x, 0) / align * align;
+	const int x1 =
+		std::min((x + w + align - 1) / align * align, layout.xres);
+	const int y0 = std::max(y, 0);
+	const int y1 = std::min(y + h, layout.yres);
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	size_t offsets[3], sizes[3];
+	const int planes = frame_planes(layout, offsets, sizes);
+	for (int plane = 0; plane < planes; ++plane) {
+		const size_t stride = sizes[plane] * layout.xres;
+		const size_t start =
+			offsets[plane] + y0 * stride + x0 * sizes[plane];
+		const size_t span = (size_t)(x1 - x0) * sizes[plane];
+		for (int row = y0; row < y1; ++row)
+			memcpy(dst + start + (row - y0) * stride,
+			       src + start + (row - y0) * stride, span);
+	}
+}
+
+void blit_rect(const FrameLayout &dst_layout, uint8_t *dst, int dx, int dy,
+	       const FrameLayout &src_layout, const uint8_t *src, int sx,
+	       int sy, int w, int h)
+{
+	size_t dst_offsets[3], src_offsets[3], sizes[3];
+	const int planes = frame_planes(dst_layout, dst_offsets, sizes);
+	frame_planes(src_layout, src_offsets, sizes);
+	for (int plane = 0; plane < planes; ++plane) {
+		const size_t dst_stride = sizes[plane] * dst_layout.xres;
+		const size_t src_stride = sizes[plane] * src_layout.xres;
+		uint8_t *p_dst = dst + dst_offsets[plane] + dy * dst_stride +
+				 dx * sizes[plane];
+		const uint8_t *p_src = src + src_offsets[plane] +
+				       sy * src_stride + sx * sizes[plane];
+		const size_t span = (size_t)w * sizes[plane];
+		for (int row = 0; row < h; ++row, p_dst += dst_stride,
+			 p_src += src_stride)
+			memcpy(p_dst, p_src, span);
+	}
+}
+
+void rgb_to_ycbcr12(const uint32_t *rgbx, int16_t *y, int16_t *cb,
+		    int16_t *cr, int n, const YcbcrCoeffs &coeffs)
+{
+	ycbcr_impl(rgbx, y, cb, cr, 0, n, coeffs);
+}
+
+void pack_v210_rows(const FrameLayout &layout, const uint8_t *p216,
+		    uint8_t *v210, int first_row, int last_row)
+{
+	const size_t plane = layout.line_stride * layout.yres;
+	const size_t v210_stride = v210_line_stride(layout.xres);
+	for (int row = first_row; row < last_row; ++row) {
+		const uint8_t *p_y = p216 + row * layout.line_stride;
+		uint8_t *dst = v210 + row * v210_stride;
+		pack_impl((const uint16_t *)p_y, (const uint16_t *)(p_y + plane),
+			  (uint32_t *)dst, layout.xres);
+		// Zero the padding up to the 128-byte row boundary
+		const size_t used = (size_t)(layout.xres + 5) / 6 * 16;
+		memset(dst + used, 0, v210_stride - used);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "FrameLayout.h"
+
+// Instruction set used by the fill kernels, in increasing order
+enum class FillIsa { Scalar, SSE2, AVX2, AVX512 };
+
+// Frames at least this large are filled with non-temporal stores so they do
+// not evict the working set from the cache
+static constexpr size_t FILL_STREAM_THRESHOLD = 4 * 1024 * 1024;
+
+// Pick the best kernels for this CPU. Call once at startup, before any
+// thread renders; until then the scalar kernels run. max_isa caps the
+// choice (used by FillBench).
+void fill_kernels_init(FillIsa max_isa = FillIsa::AVX512);
+
+// Best instruction set supported by the CPU and OS
+FillIsa fill_kernels_detect();
+// Instruction set currently selected
+FillIsa fill_kernels_isa();
+const char *fill_isa_name(FillIsa isa);
+
+// Fill bytes at dst with a repeating little-endian 32-bit pattern. dst need
+// not be aligned and bytes need not be a multiple of 4.
+void fill_pattern32(uint8_t *dst, size_t bytes, uint32_t pattern);
+// Same, but with non-temporal stores for buffers that will not be read back
+// soon. Ends with a store fence.
+void fill_pattern32_stream(uint8_t *dst, size_t bytes, uint32_t pattern);
+
+// Fill a whole frame with a single packed color (see get_pattern_colors for
+// packing). Handles UYVY, UYVA (packed plane plus alpha plane), P216, PA16,
+// BGRA, BGRX, RGBA and RGBX. Uses non-temporal stores above FILL_STREAM_THRESHOLD.
+void fill_frame(const FrameLayout &layout, uint8_t *p_data, uint32_t color);
+// Same for rows [first_row, last_row) only, so bands of one frame can be
+// filled in parallel. These wrappers pick the PatternRenderer on every call;
+// per-frame code selects it once instead.
+void fill_frame_rows(const FrameLayout &layout, uint8_t *p_data,
+		     uint32_t color, int first_row, int last_row);
+
+// Fill the rectangle x, y, w, h of a frame with a single packed color,
+// clipped to the frame. On UYVY/UYVA the rectangle is widened to whole
+// chroma pairs and the alpha plane is filled too. Uses cached stores since
+// rectangles are small.
+void fill_rect(const FrameLayout &layout, uint8_t *p_data, int x, int y,
+	       int w, int h, uint32_t color);
+
+// Copy the rectangle x, y, w, h of every plane of src to dst, two frames of
+// the same layout, clipped and widened like fill_rect
+void copy_rect(const FrameLayout &layout, uint8_t *dst, const uint8_t *src,
+	       int x, int y, int w, int h);
+
+// Copy the w x h rectangle at sx, sy of every plane of src, a frame of
+// src_layout, to dx, dy of dst, a frame of dst_layout with the same FourCC.
+// Nothing is clipped; on 4:2:2 x and w must be whole chroma pairs.
+void blit_rect(const FrameLayout &dst_layout, uint8_t *dst, int dx, int dy,
+	       const FrameLayout &src_layout, const uint8_t *src, int sx,
+	       int sy, int w, int h);
+
+// RGB to 10-bit studio range Y'CbCr in Q12 fixed point: Y = 64 + y . RGB,
+// Cb = 512 + cb . RGB, Cr = 512 + cr . RGB
+struct YcbcrCoeffs {
+	int16_t y[3];
+	int16_t cb[3];
+	int16_t cr[3];
+};
+
+// Convert n RGBX pixels (little-endian words R | G << 8 | B << 16) to one
+// Y, Cb and Cr sample each, with 2 bits below the 10-bit scale (Y 256 to
+// 3760) so that 8 and 10-bit output is rounded only once. Uses SSE2
+// multiply-adds when any SIMD kernels are selected.
+void rgb_to_ycbcr12(const uint32_t *rgbx, int16_t *y, int16_t *cb,
+		    int16_t *cr, int n, const YcbcrCoeffs &coeffs);
+
+// Pack rows [first_row, last_row) of a P216/PA16 frame into V210 rows of
+// v210_line_stride(layout.xres) bytes; alpha is dropped. Uses SSSE3
+// shuffles when the AVX2 or AVX-512 kernels are selected.
+void pack_v210_rows(const FrameLayout &layout, const uint8_t *p216,
+		    uint8_t *v210, int first_row, int last_row);
@@ -0,0 +1,229 @@
+#include "FrameArena.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static const size_t huge_page_size = 2 * 1024 * 1024;
+
+static size_t page_size()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+static size_t round_up(size_t bytes, size_t align)
+{
+	return (bytes + align - 1) / align * align;
+}
+
+// Write one byte per page so the OS backs the whole buffer now
+static void prefault(void *p_data, size_t bytes, size_t page)
+{
+	volatile uint8_t *p = (volatile uint8_t *)p_data;
+	for (size_t offset = 0; offset < bytes; offset += page)
+		p[offset] = 0;
+}
+
+#ifdef _WIN32
+// Large pages need SeLockMemoryPrivilege, which only an account granted
+// "Lock pages in memory" can enable. Tried once per process.
+static bool enable_large_pages()
+{
+	static int enabled = -1;
+	if (enabled >= 0)
+		return enabled == 1;
+
+	enabled = 0;
+	HANDLE token;
+	if (!OpenProcessToken(GetCurrentProcess(),
+			      TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+		return false;
+	TOKEN_PRIVILEGES privileges = {};
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	if (LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME,
+				 &privileges.Privileges[0].Luid) &&
+	    AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL) &&
+	    GetLastError() == ERROR_SUCCESS)
+		enabled = GetLargePageMinimum() ? 1 : 0;
+	CloseHandle(token);
+	return enabled == 1;
+}
+#endif
+
+FrameArena &FrameArena::instance()
+{
+	static FrameArena arena;
+	return arena;
+}
+
+FrameArena::FrameArena() : reused_(0) {}
+
+FrameArena::~FrameArena()
+{
+	for (const Block &block : blocks_)
+		unmap_block(block);
+}
+
+bool FrameArena::map_block(size_t bytes, Block &block)
+{
+	const size_t page = page_size();
+	block.in_use = true;
+
+	if (bytes >= HUGE_PAGE_THRESHOLD) {
+#ifdef _WIN32
+		if (enable_large_pages()) {
+			const size_t large = GetLargePageMinimum();
+			block.size = round_up(bytes, large);
+			block.p_data = VirtualAlloc(NULL, block.size,
+						    MEM_RESERVE | MEM_COMMIT |
+							    MEM_LARGE_PAGES,
+						    PAGE_READWRITE);
+			if (block.p_data) {
+				block.kind = Kind::LargePage;
+				prefault(block.p_data, block.size, large);
+				return true;
+			}
+		}
+#else
+		block.size = round_up(bytes, huge_page_size);
+#ifdef MAP_HUGETLB
+		// Explicit huge pages, if the administrator reserved some
+		block.p_data = mmap(NULL, block.size, PROT_READ | PROT_WRITE,
+				    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+				    -1, 0);
+		if (block.p_data != MAP_FAILED) {
+			block.kind = Kind::LargePage;
+			prefault(block.p_data, block.size, huge_page_size);
+			return true;
+		}
+#endif
+		// Transparent huge pages need 2 MB alignment
+		if (posix_memalign(&block.p_data, huge_page_size, block.size) ==
+		    0) {
+#ifdef MADV_HUGEPAGE
+			madvise(block.p_data, block.size, MADV_HUGEPAGE);
+#endif
+			block.kind = Kind::HugePage;
+			prefault(block.p_data, block.size, page);
+			return true;
+		}
+#endif
+	}
+
+	// Small buffers only need cache line alignment
+	const size_t align = bytes >= page ? page : ALIGNMENT;
+	block.size = round_up(bytes, align);
+	block.kind = Kind::Heap;
+#ifdef _WIN32
+	block.p_data = _aligned_malloc(block.size, align);
+#else
+	if (posix_memalign(&block.p_data, align, block.size) != 0)
+		block.p_data = nullptr;
+#endif
+	if (!block.p_data)
+		return false;
+	prefault(block.p_data, block.size, page);
+	return true;
+}
+
+void FrameArena::unmap_block(const Block &block)
+{
+	switch (block.kind) {
+	case Kind::LargePage:
+#ifdef _WIN32
+		VirtualFree(block.p_data, 0, MEM_RELEASE);
+#else
+		munmap(block.p_data, block.size);
+#endif
+		break;
+	case Kind::HugePage:
+	case Kind::Heap:
+	default:
+#ifdef _WIN32
+		_aligned_free(block.p_data);
+#else
+		free(block.p_data);
+#endif
+		break;
+	}
+}
+
+void *FrameArena::allocate(size_t bytes)
+{
+	if (bytes == 0)
+		bytes = 1;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	// Reuse a free block that fits without wasting more than an eighth
+	Block *best = nullptr;
+	for (Block &block : blocks_) {
+		if (!block.in_use && block.size >= bytes &&
+		    block.size <= bytes + bytes / 8 &&
+		    (!best || block.size < best->size))
+			best = &block;
+	}
+	if (best) {
+		best->in_use = true;
+		++reused_;
+		return best->p_data;
+	}
+
+	Block block;
+	if (!map_block(bytes, block))
+		return nullptr;
+	blocks_.push_back(block);
+	return block.p_data;
+}
+
+void FrameArena::release(void *p_data)
+{
+	if (!p_data)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (Block &block : blocks_) {
+		if (block.p_data == p_data) {
+			block.in_use = false;
+			return;
+		}
+	}
+}
+
+size_t FrameArena::mapped_bytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	size_t bytes = 0;
+	for (const Block &block : blocks_)
+		bytes += block.size;
+	return bytes;
+}
+
+size_t FrameArena::huge_page_bytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	size_t bytes = 0;
+	for (const Block &block : blocks_) {
+		if (block.kind != Kind::Heap)
+			bytes += block.size;
+	}
+	return bytes;
+}
+
+size_t FrameArena::reused() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return reused_;
+}
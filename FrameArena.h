@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Allocator for video and audio buffers.
+//
+// Buffers are 64-byte aligned (page aligned from one page up) and every page
+// is touched before the buffer is returned, so no page fault lands in a
+// timed frame. Buffers of HUGE_PAGE_THRESHOLD and up are backed by huge
+// pages when the OS allows it: explicit large pages first, then transparent
+// huge pages on Linux. Released buffers stay mapped in a pool and are handed
+// out again for requests of the same size, so streams that come and go do
+// not map and fault fresh memory.
+class FrameArena {
+public:
+	static constexpr size_t ALIGNMENT = 64;
+	static constexpr size_t HUGE_PAGE_THRESHOLD = 8 * 1024 * 1024;
+
+	// The process-wide arena
+	static FrameArena &instance();
+
+	// Returns nullptr if the memory cannot be allocated
+	void *allocate(size_t bytes);
+	// Return a buffer from allocate() to the pool
+	void release(void *p_data);
+
+	// Bytes mapped in total, and how many of them are on (or advised to
+	// use) huge pages
+	size_t mapped_bytes() const;
+	size_t huge_page_bytes() const;
+	// allocate() calls served from the pool
+	size_t reused() const;
+
+private:
+	enum class Kind { Heap, LargePage, HugePage };
+	struct Block {
+		void *p_data;
+		size_t size;
+		Kind kind;
+		bool in_use;
+	};
+
+	FrameArena();
+	~FrameArena();
+
+	FrameArena(const FrameArena &) = delete;
+	FrameArena &operator=(const FrameArena &) = delete;
+
+	static bool map_block(size_t bytes, Block &block);
+	static void unmap_block(const Block &block);
+
+	mutable std::mutex mutex_;
+	std::vector<Block> blocks_;
+	size_t reused_;
+};
@@ -0,0 +1,82 @@
+#include "FrameCache.h"
+#include <cstring>
+#include "FillKernels.h"
+#include "FrameArena.h"
+
+FrameCache::FrameCache(RenderPool *render_pool)
+	: total_bytes_(0), render_pool_(render_pool)
+{
+}
+
+FrameCache::~FrameCache()
+{
+	for (auto &entry : frames_)
+		FrameArena::instance().release(entry.second);
+	for (auto &entry : card_frames_)
+		FrameArena::instance().release(entry.second);
+}
+
+uint8_t *FrameCache::get(const FrameLayout &layout, uint32_t color,
+			 int bands)
+{
+	Key key((int)layout.fourcc, layout.xres, layout.yres, color);
+	auto it = frames_.find(key);
+	if (it != frames_.end())
+		return it->second;
+
+	uint8_t *p_data =
+		(uint8_t *)FrameArena::instance().allocate(layout.total_size);
+	if (!p_data)
+		return nullptr;
+
+	if (render_pool_) {
+		render_pool_->run(layout.yres, bands, [&](int first, int last) {
+			fill_frame_rows(layout, p_data, color, first, last);
+		});
+	} else {
+		fill_frame(layout, p_data, color);
+	}
+	frames_[key] = p_data;
+	total_bytes_ += layout.total_size;
+	return p_data;
+}
+
+uint8_t *FrameCache::get_card(const FrameLayout &layout, const TestCard &card,
+			      ColorMatrix matrix, bool flash,
+			      uint32_t flash_color, int bands)
+{
+	CardKey key(&card, (int)layout.fourcc, layout.xres, layout.yres,
+		    (int)matrix, flash, flash ? flash_color : 0);
+	auto it = card_frames_.find(key);
+	if (it != card_frames_.end())
+		return it->second;
+
+	uint8_t *p_data =
+		(uint8_t *)FrameArena::instance().allocate(layout.total_size);
+	if (!p_data)
+		return nullptr;
+
+	// The card is converted once per format and resolution; the flash
+	// frame copies it and draws only the flash
+	if (flash) {
+		uint8_t *p_card = get_card(layout, card, matrix, false, 0, bands);
+		if (!p_card) {
+			FrameArena::instance().release(p_data);
+			return nullptr;
+		}
+		memcpy(p_data, p_card, layout.total_size);
+		const CardFlashRect rect =
+			card_flash_rect(layout.xres, layout.yres);
+		fill_rect(layout, p_data, rect.x, rect.y, rect.w, rect.h,
+			  flash_color);
+	} else if (render_pool_) {
+		render_pool_->run(layout.yres, bands, [&](int first, int last) {
+			card.render_rows(layout, matrix, p_data, first, last);
+		});
+	} else {
+		card.render_rows(layout, matrix, p_data, 0, layout.yres);
+	}
+	card_frames_[key] = p_data;
+	total_bytes_ += layout.total_size;
+	return p_data;
+}
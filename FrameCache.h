@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include "FrameLayout.h"
+#include "RenderPool.h"
+#include "TestCard.h"
+
+// Holds one pre-rendered frame per distinct (FourCC, resolution, color), and
+// per test card frame.
+// Frames are rendered on first request and then only handed out by pointer,
+// so the send loop never touches the pixels of a solid-color frame again.
+// Large frames are rendered in bands on a RenderPool when one is given.
+class FrameCache {
+public:
+	explicit FrameCache(RenderPool *render_pool = nullptr);
+	~FrameCache();
+
+	FrameCache(const FrameCache &) = delete;
+	FrameCache &operator=(const FrameCache &) = delete;
+
+	// Return the cached frame for layout/color, rendering it if needed.
+	// bands is passed to RenderPool::run. Returns nullptr if the frame could
+	// not be allocated.
+	uint8_t *get(const FrameLayout &layout, uint32_t color, int bands = 0);
+
+	// Return the cached frame of card converted with matrix, with the sync
+	// flash (card_flash_rect) in flash_color over it when flash is set.
+	uint8_t *get_card(const FrameLayout &layout, const TestCard &card,
+			  ColorMatrix matrix, bool flash, uint32_t flash_color,
+			  int bands = 0);
+
+	size_t frame_count() const
+	{
+		return frames_.size() + card_frames_.size();
+	}
+	size_t total_bytes() const { return total_bytes_; }
+
+private:
+	typedef std::tuple<int, int, int, uint32_t> Key; // FourCC, xres, yres, color
+	std::map<Key, uint8_t *> frames_;
+	// Card, FourCC, xres, yres, matrix, flash, flash color
+	typedef std::tuple<const TestCard *, int, int, int, int, bool, uint32_t>
+		CardKey;
+	std::map<CardKey, uint8_t *> card_frames_;
+	size_t total_bytes_;
+	RenderPool *render_pool_;
+};
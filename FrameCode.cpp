@@ -0,0 +1,192 @@
+#include "FrameCode.h"
+#include <cstring>
+
+bool parse_frame_code_corner(const char *arg, FrameCodeCorner &corner)
+{
+	if (strcmp(arg, "tl") == 0)
+		corner = FrameCodeCorner::TopLeft;
+	else if (strcmp(arg, "tr") == 0)
+		corner = FrameCodeCorner::TopRight;
+	else if (strcmp(arg, "bl") == 0)
+		corner = FrameCodeCorner::BottomLeft;
+	else if (strcmp(arg, "br") == 0)
+		corner = FrameCodeCorner::BottomRight;
+	else
+		return false;
+	return true;
+}
+
+uint8_t frame_code_crc8(uint32_t id)
+{
+	// CRC-8/ATM, polynomial x^8 + x^2 + x + 1, over the ID bytes MSB first
+	uint8_t crc = 0;
+	for (int byte = 3; byte >= 0; --byte) {
+		crc ^= (uint8_t)(id >> (byte * 8));
+		for (int bit = 0; bit < 8; ++bit)
+			crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07)
+					   : (uint8_t)(crc << 1);
+	}
+	return crc;
+}
+
+bool frame_code_geometry(int xres, int yres, FrameCodeCorner corner,
+			 int &cell, int &x, int &y)
+{
+	// One cell of margin on each side; 16 pixel cells where they fit
+	cell = xres / (FRAME_CODE_CELLS + 2);
+	if (cell > 16)
+		cell = 16;
+	cell &= ~1;
+	if (cell < 4 || yres < 3 * cell)
+		return false;
+
+	const int width = FRAME_CODE_CELLS * cell;
+	const bool left = corner == FrameCodeCorner::TopLeft ||
+			  corner == FrameCodeCorner::BottomLeft;
+	const bool top = corner == FrameCodeCorner::TopLeft ||
+			 corner == FrameCodeCorner::TopRight;
+	x = left ? cell : ((xres - cell - width) & ~1);
+	y = top ? cell : yres - 2 * cell;
+	return true;
+}
+
+int frame_code_cell(uint32_t id, int i)
+{
+	if (i == 0 || i == FRAME_CODE_CELLS - 1)
+		return 1;
+	if (i == 1)
+		return 0;
+	// 40 payload bits: ID then CRC, MSB first
+	const uint64_t payload = ((uint64_t)id << 8) | frame_code_crc8(id);
+	return (int)((payload >> (39 - (i - 2))) & 1);
+}
+
+bool frame_code_read(const uint8_t *p_data, int xres, int yres,
+		     int line_stride, bool uyvy, FrameCodeCorner corner,
+		     uint32_t &id)
+{
+	int cell, x, y;
+	if (!frame_code_geometry(xres, yres, corner, cell, x, y))
+		return false;
+
+	const uint8_t *row = p_data + (size_t)(y + cell / 2) * line_stride;
+	uint64_t payload = 0;
+	for (int i = 0; i < FRAME_CODE_CELLS; ++i) {
+		const int px = x + i * cell + cell / 2;
+		// UYVY: Y of pixel px is byte 2 * px + 1. BGRA and RGBA: G.
+		const uint8_t luma = uyvy ? row[px * 2 + 1] : row[px * 4 + 1];
+		const int bit = luma >= 128 ? 1 : 0;
+		if (i < 2 || i == FRAME_CODE_CELLS - 1) {
+			if (bit != frame_code_cell(0, i))
+				return false;
+		} else {
+			payload = (payload << 1) | (uint64_t)bit;
+		}
+	}
+
+	id = (uint32_t)(payload >> 8);
+	return frame_code_crc8(id) == (uint8_t)(payload & 0xFF);
+}
+
+void frame_code_audio_write(float *dst, int no_samples, uint32_t id)
+{
+	const uint64_t word = ((uint64_t)FRAME_CODE_SYNC << 40) |
+			      ((uint64_t)id << 8) | frame_code_crc8(id);
+	const int half = FRAME_CODE_SAMPLES_PER_BIT / 2;
+
+	// Biphase mark: the level flips at every bit start, and once more in
+	// the middle of a 1
+	int n = 0;
+	float level = -FRAME_CODE_LEVEL;
+	for (int bit = FRAME_CODE_AUDIO_BITS - 1; bit >= 0 && n < no_samples;
+	     --bit) {
+		const bool one = (word >> bit) & 1;
+		level = -level;
+		for (int s = 0; s < FRAME_CODE_SAMPLES_PER_BIT && n < no_samples;
+		     ++s) {
+			if (one && s == half)
+				level = -level;
+			dst[n++] = level;
+		}
+	}
+	if (n < no_samples)
+		memset(dst + n, 0, (no_samples - n) * sizeof(float));
+}
+
+FrameCodeAudioDecoder::FrameCodeAudioDecoder(Callback callback)
+	: callback_(callback),
+	  level_(0),
+	  run_(0),
+	  half_(false),
+	  bits_(0),
+	  bit_count_(0),
+	  burst_time_ns_(0)
+{
+}
+
+void FrameCodeAudioDecoder::reset()
+{
+	half_ = false;
+	bits_ = 0;
+	bit_count_ = 0;
+}
+
+void FrameCodeAudioDecoder::push(const float *p_data, int no_samples,
+				 int64_t time_ns, int sample_rate)
+{
+	const float threshold = FRAME_CODE_LEVEL / 2;
+	for (int i = 0; i < no_samples; ++i) {
+		const int level = p_data[i] > threshold	   ? 1
+				  : p_data[i] < -threshold ? -1
+							   : 0;
+		if (level == level_) {
+			++run_;
+			continue;
+		}
+
+		if (level_ != 0) {
+			end_run(run_);
+		} else {
+			// Leaving silence starts a new burst
+			reset();
+			burst_time_ns_ = time_ns + (int64_t)i * 1000000000LL /
+							   sample_rate;
+		}
+		level_ = level;
+		run_ = 1;
+	}
+}
+
+void FrameCodeAudioDecoder::end_run(int length)
+{
+	// A run of one bit length is a 0; two half-bit runs are a 1
+	const int bit_len = FRAME_CODE_SAMPLES_PER_BIT;
+	int bit;
+	if (length * 4 >= bit_len * 3 && length * 2 <= bit_len * 3) {
+		if (half_) {
+			reset();
+			return;
+		}
+		bit = 0;
+	} else if (length * 4 >= bit_len && length * 4 < bit_len * 3) {
+		if (!half_) {
+			half_ = true;
+			return;
+		}
+		half_ = false;
+		bit = 1;
+	} else {
+		reset();
+		return;
+	}
+
+	bits_ = (bits_ << 1) | (uint64_t)bit;
+	if (++bit_count_ < FRAME_CODE_AUDIO_BITS)
+		return;
+
+	const uint32_t id = (uint32_t)(bits_ >> 8);
+	if ((uint16_t)(bits_ >> 40) == FRAME_CODE_SYNC &&
+	    frame_code_crc8(id) == (uint8_t)(bits_ & 0xFF))
+		callback_(id, burst_time_ns_);
+	reset();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+// Machine-readable frame ID carried in every video frame and in the audio
+// sent with it, so a receiver can measure A/V offset and count dropped
+// frames on every frame instead of once per white flash.
+//
+// Video: a row of square cells in one corner of the frame, white for 1 and
+// black for 0: a 1 0 start guard, the 32-bit ID and its CRC-8 (MSB first),
+// then a closing 1.
+//
+// Audio: a biphase-mark (LTC style) burst at the start of the frame's audio
+// on its own channel: a 16-bit sync word, the 32-bit ID and its CRC-8. Each
+// bit is FRAME_CODE_SAMPLES_PER_BIT samples long and the rest of the frame
+// is silence, which is what lets a decoder find the burst start to the
+// sample.
+
+enum class FrameCodeCorner { TopLeft, TopRight, BottomLeft, BottomRight };
+
+static constexpr int FRAME_CODE_CELLS = 2 + 32 + 8 + 1;
+static constexpr int FRAME_CODE_SAMPLES_PER_BIT = 8;
+static constexpr int FRAME_CODE_AUDIO_BITS = 16 + 32 + 8;
+static constexpr int FRAME_CODE_AUDIO_SAMPLES =
+	FRAME_CODE_AUDIO_BITS * FRAME_CODE_SAMPLES_PER_BIT;
+static constexpr uint16_t FRAME_CODE_SYNC = 0x3FFD;
+static constexpr float FRAME_CODE_LEVEL = 0.25f;
+
+// Parse "tl", "tr", "bl" or "br". Returns false for anything else.
+bool parse_frame_code_corner(const char *arg, FrameCodeCorner &corner);
+
+uint8_t frame_code_crc8(uint32_t id);
+
+// Geometry of the video code for a frame size: cell edge in pixels (even,
+// so cells start on UYVY chroma pairs) and the top-left of the first cell.
+// Returns false if the frame is too small to carry the code.
+bool frame_code_geometry(int xres, int yres, FrameCodeCorner corner,
+			 int &cell, int &x, int &y);
+
+// Value (0 or 1) of cell i of the video code for id
+int frame_code_cell(uint32_t id, int i);
+
+// Read the video code from 8-bit UYVY or BGRA/BGRX/RGBA/RGBX pixels by
+// sampling luma (or green) at every cell center. Returns false if the
+// guards or CRC do not match.
+bool frame_code_read(const uint8_t *p_data, int xres, int yres,
+		     int line_stride, bool uyvy, FrameCodeCorner corner,
+		     uint32_t &id);
+
+// Write the audio burst for id followed by silence, no_samples in total.
+// It only decodes if no_samples is more than FRAME_CODE_AUDIO_SAMPLES.
+void frame_code_audio_write(float *dst, int no_samples, uint32_t id);
+
+// Finds audio bursts in a continuous stream of samples
+class FrameCodeAudioDecoder {
+public:
+	// Called with the ID and the time of the first burst sample
+	typedef std::function<void(uint32_t id, int64_t time_ns)> Callback;
+
+	explicit FrameCodeAudioDecoder(Callback callback);
+
+	// Feed the next samples of the code channel. time_ns is the time of
+	// p_data[0]; later samples are placed by sample_rate.
+	void push(const float *p_data, int no_samples, int64_t time_ns,
+		  int sample_rate);
+
+private:
+	void end_run(int length);
+	void reset();
+
+	Callback callback_;
+	int level_;        // sign of the current run, 0 = silence
+	int run_;          // samples in the current run
+	bool half_;        // first half of a 1 bit seen
+	uint64_t bits_;    // bits shifted in since the burst started
+	int bit_count_;
+	int64_t burst_time_ns_;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+// Before the NDI headers, which use NULL without defining it
+#include <cstddef>
+#include <Processing.NDI.Lib.h>
+#include <cstdint>
+
+// "format" value of a .cfg file for 10-bit V210. NDI has no V210 FourCC,
+// so these streams are generated and sent as P216, and packed to V210 by
+// sinks that write raw frames.
+static constexpr int V210_FORMAT = 808530550; // 'v210'
+
+inline bool is_v210_format(int fmt)
+{
+	return fmt == V210_FORMAT || fmt == 8;
+}
+
+// Map the "format" value of a .cfg file to a FourCC
+inline NDIlib_FourCC_video_type_e get_format_enum(int fmt)
+{
+	switch (fmt) {
+	case 1498831189:
+		return NDIlib_FourCC_type_UYVY;
+	case 1096178005:
+		return NDIlib_FourCC_type_UYVA;
+	case 1095911234:
+		return NDIlib_FourCC_type_BGRA;
+	case 3:
+		return NDIlib_FourCC_type_RGBA;
+	case 4:
+		return NDIlib_FourCC_type_RGBX;
+	case 5:
+		return NDIlib_FourCC_type_BGRX;
+	case 909193808:
+	case 6:
+	case V210_FORMAT:
+	case 8:
+		return NDIlib_FourCC_type_P216;
+	case 909197648:
+	case 7:
+		return NDIlib_FourCC_type_PA16;
+	default:
+		break;
+	}
+	return NDIlib_FourCC_type_UYVY;
+}
+
+// Printable name of a FourCC, e.g. "UYVY"
+inline const char *fourcc_name(NDIlib_FourCC_video_type_e fourcc,
+			       char (&name)[5])
+{
+	for (int i = 0; i < 4; ++i)
+		name[i] = (char)(((uint32_t)fourcc >> (8 * i)) & 0xFF);
+	name[4] = 0;
+	return name;
+}
+
+// Memory layout of one video frame for a given FourCC and resolution
+struct FrameLayout {
+	NDIlib_FourCC_video_type_e fourcc;
+	int xres;
+	int yres;
+	size_t line_stride;      // bytes per row of the first plane
+	size_t plane1_size;      // bytes in the packed plane, or the Y and
+				 // CbCr planes of P216/PA16
+	size_t alpha_plane_size; // bytes in the UYVA/PA16 alpha plane, else 0
+	size_t total_size;       // bytes to allocate for the whole frame
+};
+
+inline FrameLayout get_frame_layout(NDIlib_FourCC_video_type_e fourcc,
+				    int xres, int yres)
+{
+	FrameLayout layout = {};
+	layout.fourcc = fourcc;
+	layout.xres = xres;
+	layout.yres = yres;
+
+	if (fourcc == NDIlib_FourCC_type_UYVY) {
+		layout.line_stride = (size_t)xres * 2; //2 bytes per pixel (UYVY packed)
+		layout.plane1_size = (size_t)xres * (size_t)yres * 2;
+	} else if (fourcc == NDIlib_FourCC_type_UYVA) {
+		// UYVA: first a UYVY plane (2 bytes per pixel), then an alpha plane (1 byte per pixel)
+		layout.line_stride = (size_t)xres * 2;
+		layout.plane1_size = (size_t)xres * (size_t)yres * 2;
+		layout.alpha_plane_size = (size_t)xres * (size_t)yres;
+	} else if (fourcc == NDIlib_FourCC_type_P216 ||
+		   fourcc == NDIlib_FourCC_type_PA16) {
+		// 16-bit semi-planar: a Y plane, then a plane of interleaved
+		// Cb, Cr pairs with the same stride (then 16-bit alpha on PA16)
+		layout.line_stride = (size_t)xres * 2;
+		layout.plane1_size = (size_t)xres * (size_t)yres * 4;
+		if (fourcc == NDIlib_FourCC_type_PA16)
+			layout.alpha_plane_size =
+				(size_t)xres * (size_t)yres * 2;
+	} else {
+		//32-bit packed formats:4 bytes per pixel
+		layout.line_stride = (size_t)xres * 4;
+		layout.plane1_size = (size_t)xres * (size_t)yres * 4;
+	}
+	layout.total_size = layout.plane1_size + layout.alpha_plane_size;
+	return layout;
+}
+
+// Bytes per row of a V210 frame: 6 pixels per 16 bytes, rows padded to 128
+inline size_t v210_line_stride(int xres)
+{
+	return (size_t)(xres + 47) / 48 * 128;
+}
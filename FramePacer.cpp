@@ -0,0 +1,136 @@
+#include "FramePacer.h"
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <thread>
+#include "PlatformTime.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// Upper bounds of the late-wake buckets in ns; the last bucket is open ended
+static const int64_t bucket_limits[FramePacer::N_BUCKETS - 1] = {
+	10000,   20000,   50000,   100000,  200000,
+	500000,  1000000, 2000000, 5000000, 10000000};
+static const char *bucket_names[FramePacer::N_BUCKETS] = {
+	"<10us",  "<20us", "<50us", "<100us", "<200us", "<500us",
+	"<1ms",   "<2ms",  "<5ms",  "<10ms",  ">=10ms"};
+
+FramePacer::FramePacer(const std::string &name, int frame_rate_N,
+		       int frame_rate_D, uint64_t spin_ns)
+	: rate_N_((uint64_t)frame_rate_N),
+	  rate_D_((uint64_t)frame_rate_D),
+	  spin_ns_(spin_ns),
+	  start_ns_(0),
+	  next_frame_(0),
+	  last_late_ns_(0),
+	  skipped_(0),
+	  late_wake_(name),
+	  waits_(0),
+	  max_late_ns_(0),
+	  sum_late_ns_(0.0),
+	  sum_sq_late_ns_(0.0)
+{
+	for (uint64_t &bucket : buckets_)
+		bucket = 0;
+
+#ifdef _WIN32
+	// Default Windows timer resolution is 15.6 ms; ask for 1 ms so the sleep
+	// phase ends close to where the spin phase starts
+	timeBeginPeriod(1);
+#endif
+}
+
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::start(uint64_t start_ns)
+{
+	start_ns_ = start_ns;
+	next_frame_ = 0;
+}
+
+uint64_t FramePacer::deadline(uint64_t n) const
+{
+	// n * (D / N) seconds, computed exactly in integer ns
+	return start_ns_ + util_mul_div64(n, 1000000000ULL * rate_D_, rate_N_);
+}
+
+uint64_t FramePacer::wait_next()
+{
+	uint64_t frame = next_frame_;
+	uint64_t due = deadline(frame);
+	uint64_t now = os_gettime_ns();
+
+	// More than a whole frame behind: skip to the frame that is due now
+	if (now > due && now - due >= deadline(frame + 1) - due) {
+		uint64_t behind = frame;
+		while (deadline(frame + 1) <= now)
+			++frame;
+		skipped_ += frame - behind;
+		due = deadline(frame);
+	}
+
+	// Sleep the coarse part, spin the rest
+	if (due > now + spin_ns_) {
+		std::this_thread::sleep_for(
+			std::chrono::nanoseconds(due - now - spin_ns_));
+	}
+	while ((now = os_gettime_ns()) < due)
+		os_cpu_relax();
+
+	last_late_ns_ = (int64_t)(now - due);
+	next_frame_ = frame + 1;
+
+	late_wake_.histogram().record(last_late_ns_);
+	++buckets_[bucket_of(last_late_ns_)];
+	++waits_;
+	if (last_late_ns_ > max_late_ns_)
+		max_late_ns_ = last_late_ns_;
+	sum_late_ns_ += (double)last_late_ns_;
+	sum_sq_late_ns_ += (double)last_late_ns_ * (double)last_late_ns_;
+
+	return frame;
+}
+
+int FramePacer::bucket_of(int64_t late_ns)
+{
+	int bucket = 0;
+	while (bucket < N_BUCKETS - 1 && late_ns >= bucket_limits[bucket])
+		++bucket;
+	return bucket;
+}
+
+void FramePacer::report()
+{
+	if (waits_ == 0)
+		return;
+
+	const double mean = sum_late_ns_ / (double)waits_;
+	const double var = sum_sq_late_ns_ / (double)waits_ - mean * mean;
+	printf("%s (%llu waits): late mean=%.0f ns, "
+	       "jitter=%.0f ns, max=%lld ns, skipped=%llu\n",
+	       late_wake_.name().c_str(), (unsigned long long)waits_, mean,
+	       std::sqrt(var > 0 ? var : 0),
+	       (long long)max_late_ns_, (unsigned long long)skipped_);
+	printf("  late wake:");
+	for (int i = 0; i < N_BUCKETS; ++i) {
+		if (buckets_[i])
+			printf(" %s=%llu", bucket_names[i],
+			       (unsigned long long)buckets_[i]);
+		buckets_[i] = 0;
+	}
+	printf("\n");
+
+	waits_ = 0;
+	max_late_ns_ = 0;
+	sum_late_ns_ = 0.0;
+	sum_sq_late_ns_ = 0.0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "PerfTimer.h"
+
+// Paces a loop to absolute per-frame deadlines derived from a rational frame
+// rate, so errors never accumulate. Each wait sleeps until shortly before the
+// deadline and spins the rest of the way, then records how late it woke.
+// Late wakes go into a PerfTimer, so the PerfReporter thread reports them
+// and the paced loop never formats output.
+class FramePacer {
+public:
+	// name: the late-wake timer's name in perf reports
+	// spin_ns: how long before a deadline to stop sleeping and start spinning
+	FramePacer(const std::string &name, int frame_rate_N, int frame_rate_D,
+		   uint64_t spin_ns = DEFAULT_SPIN_NS);
+	~FramePacer();
+
+	FramePacer(const FramePacer &) = delete;
+	FramePacer &operator=(const FramePacer &) = delete;
+
+	// Make frame 0 due at start_ns (os_gettime_ns time)
+	void start(uint64_t start_ns);
+
+	// Deadline of frame n in os_gettime_ns time
+	uint64_t deadline(uint64_t n) const;
+	// Deadline of the frame the next wait_next() waits for
+	uint64_t next_deadline() const { return deadline(next_frame_); }
+
+	// Wait for the next frame's deadline and return its frame number. When
+	// the loop has fallen more than a frame behind, frames are skipped
+	// instead of sent back to back, and counted in skipped().
+	uint64_t wait_next();
+
+	// How late the last wait woke up, in ns
+	int64_t last_late_ns() const { return last_late_ns_; }
+	uint64_t skipped() const { return skipped_; }
+
+	// Late-wake histogram bucket of a wake late_ns late
+	static int bucket_of(int64_t late_ns);
+
+	// Print the late-wake histogram of all waits so far and reset it.
+	// Call once the paced loop has stopped.
+	void report();
+
+	static constexpr uint64_t DEFAULT_SPIN_NS = 1500000;
+	static constexpr int N_BUCKETS = 11;
+
+private:
+	const uint64_t rate_N_;
+	const uint64_t rate_D_;
+	const uint64_t spin_ns_;
+	uint64_t start_ns_;
+	uint64_t next_frame_;
+	int64_t last_late_ns_;
+	uint64_t skipped_;
+
+	PerfTimer late_wake_;
+
+	// Late-wake histogram for report()
+	uint64_t buckets_[N_BUCKETS];
+	uint64_t waits_;
+	int64_t max_late_ns_;
+	double sum_late_ns_;
+	double sum_sq_late_ns_;
+};
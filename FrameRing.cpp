@@ -0,0 +1,58 @@
+#include "FrameRing.h"
+#include "FrameArena.h"
+
+FrameRing::FrameRing() : next_(0), held_(-1) {}
+
+FrameRing::~FrameRing()
+{
+	clear();
+}
+
+void FrameRing::clear()
+{
+	for (uint8_t *p_data : slots_)
+		FrameArena::instance().release(p_data);
+	slots_.clear();
+	next_ = 0;
+	held_ = -1;
+}
+
+bool FrameRing::allocate(const FrameLayout &layout, int count)
+{
+	clear();
+	for (int i = 0; i < count; ++i) {
+		uint8_t *p_data = (uint8_t *)FrameArena::instance().allocate(
+			layout.total_size);
+		if (!p_data) {
+			clear();
+			return false;
+		}
+		slots_.push_back(p_data);
+	}
+	return true;
+}
+
+int FrameRing::acquire()
+{
+	const int n = (int)slots_.size();
+	for (int i = 0; i < n; ++i) {
+		int slot = (next_ + i) % n;
+		if (slot != held_) {
+			next_ = (slot + 1) % n;
+			return slot;
+		}
+	}
+	return -1;
+}
+
+void FrameRing::submitted(const uint8_t *p_data)
+{
+	// Submitting a new frame releases the previous one
+	held_ = -1;
+	for (int i = 0; i < (int)slots_.size(); ++i) {
+		if (slots_[i] == p_data) {
+			held_ = i;
+			break;
+		}
+	}
+}
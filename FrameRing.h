@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "FrameLayout.h"
+
+// Ring of preallocated video buffers for NDIlib_send_send_video_async_v2.
+//
+// The SDK keeps using a frame passed to send_video_async until the next
+// send_video/send_video_async call (or a NULL flush), so exactly the most
+// recently submitted buffer is owned by the SDK at any time. The ring tracks
+// that owner and never hands it out for rendering.
+class FrameRing {
+public:
+	FrameRing();
+	~FrameRing();
+
+	FrameRing(const FrameRing &) = delete;
+	FrameRing &operator=(const FrameRing &) = delete;
+
+	// Allocate count buffers for layout. Returns false on allocation failure.
+	bool allocate(const FrameLayout &layout, int count);
+
+	// Index of the next buffer that the SDK does not hold, or -1 if none
+	int acquire();
+
+	// Record that p_data was just passed to send_video_async. Buffers that
+	// are not part of the ring (e.g. cached frames) are accepted too; they
+	// still release whichever ring buffer the SDK held before.
+	void submitted(const uint8_t *p_data);
+
+	// Record a synchronous send or a NULL flush: the SDK holds nothing
+	void flushed() { held_ = -1; }
+
+	uint8_t *data(int slot) const { return slots_[slot]; }
+	int count() const { return (int)slots_.size(); }
+	bool held(int slot) const { return slot == held_; }
+
+private:
+	void clear();
+
+	std::vector<uint8_t *> slots_;
+	int next_;
+	int held_; // slot owned by the SDK, -1 if none
+};
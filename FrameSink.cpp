@@ -0,0 +1,222 @@
+#include "FrameSink.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "FillKernels.h"
+#include "FrameArena.h"
+
+bool parse_sink_type(const char *name, SinkType &type)
+{
+	if (strcmp(name, "ndi") == 0) {
+		type = SinkType::Ndi;
+	} else if (strcmp(name, "null") == 0) {
+		type = SinkType::Null;
+	} else if (strcmp(name, "file") == 0) {
+		type = SinkType::RawFile;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+// V210 copy of P216 frames, for sinks that take raw frames. NDI itself has
+// no V210, so the NDI sink sends the P216 frames as they are.
+class V210Packer {
+public:
+	V210Packer() : p_data_(nullptr), frame_bytes_(0), layout_() {}
+	~V210Packer() { FrameArena::instance().release(p_data_); }
+
+	bool allocate(const FrameLayout &layout)
+	{
+		layout_ = layout;
+		frame_bytes_ = v210_line_stride(layout.xres) * layout.yres;
+		p_data_ = (uint8_t *)FrameArena::instance().allocate(
+			frame_bytes_);
+		return p_data_ != nullptr;
+	}
+	const uint8_t *pack(const NDIlib_video_frame_v2_t &frame)
+	{
+		pack_v210_rows(layout_, frame.p_data, p_data_, 0,
+			       layout_.yres);
+		return p_data_;
+	}
+	size_t frame_bytes() const { return frame_bytes_; }
+
+private:
+	uint8_t *p_data_;
+	size_t frame_bytes_;
+	FrameLayout layout_;
+};
+
+#ifndef SYNCTEST_NO_NDI
+// NDI sender on the network
+class NdiSink : public FrameSink {
+public:
+	NdiSink() : pNDI_send_(nullptr) {}
+	~NdiSink() override
+	{
+		if (pNDI_send_)
+			NDIlib_send_destroy(pNDI_send_);
+	}
+
+	bool open(const SinkParams &params) override
+	{
+		NDIlib_send_create_t NDI_send_create_desc{};
+		NDI_send_create_desc.p_ndi_name = params.name.c_str();
+		NDI_send_create_desc.clock_audio = false;
+		NDI_send_create_desc.clock_video = params.clock_video;
+		pNDI_send_ = NDIlib_send_create(&NDI_send_create_desc);
+		return pNDI_send_ != nullptr;
+	}
+
+	void send_video(const NDIlib_video_frame_v2_t &frame) override
+	{
+		NDIlib_send_send_video_v2(pNDI_send_, &frame);
+	}
+	void send_video_async(const NDIlib_video_frame_v2_t *frame) override
+	{
+		NDIlib_send_send_video_async_v2(pNDI_send_, frame);
+	}
+	void send_audio(const NDIlib_audio_frame_v2_t &frame) override
+	{
+		NDIlib_send_send_audio_v2(pNDI_send_, &frame);
+	}
+
+	const char *type_name() const override { return "NDI"; }
+	int connections() override
+	{
+		return NDIlib_send_get_no_connections(pNDI_send_, 0);
+	}
+
+private:
+	NDIlib_send_instance_t pNDI_send_;
+};
+#endif
+
+// Discards every frame. Nothing clocks video, so without deadline pacing
+// the stream runs as fast as it can render. V210 streams are still packed,
+// so the packing is part of what gets measured.
+class NullSink : public FrameSink {
+public:
+	NullSink() : v210_(false) {}
+
+	bool open(const SinkParams &params) override
+	{
+		v210_ = params.v210;
+		return !v210_ || packer_.allocate(params.layout);
+	}
+	void send_video(const NDIlib_video_frame_v2_t &frame) override
+	{
+		if (v210_)
+			packer_.pack(frame);
+	}
+	void send_audio(const NDIlib_audio_frame_v2_t &) override {}
+	const char *type_name() const override { return "null"; }
+
+private:
+	bool v210_;
+	V210Packer packer_;
+};
+
+// Appends every video frame to <folder>/<file_name>.yuv (.v210 for V210,
+// .raw for RGB formats) and writes one line per frame to <file_name>.idx:
+//
+//   # <FourCC> <xres>x<yres> <frame_rate_N>/<frame_rate_D> <frame bytes>
+//   <frame number> <byte offset> <timestamp in 100 ns>
+//
+// Audio is not written.
+class RawFileSink : public FrameSink {
+public:
+	explicit RawFileSink(const std::string &folder)
+		: folder_(folder),
+		  data_(nullptr),
+		  index_(nullptr),
+		  frame_bytes_(0),
+		  frames_(0),
+		  v210_(false)
+	{
+	}
+	~RawFileSink() override
+	{
+		if (data_)
+			fclose(data_);
+		if (index_)
+			fclose(index_);
+	}
+
+	bool open(const SinkParams &params) override
+	{
+		const NDIlib_FourCC_video_type_e fourcc = params.layout.fourcc;
+		const bool yuv = fourcc == NDIlib_FourCC_type_UYVY ||
+				 fourcc == NDIlib_FourCC_type_UYVA ||
+				 fourcc == NDIlib_FourCC_type_P216 ||
+				 fourcc == NDIlib_FourCC_type_PA16;
+		v210_ = params.v210;
+		const std::string base = folder_ + "/" + params.file_name;
+		const std::string data_path =
+			base + (v210_ ? ".v210" : yuv ? ".yuv" : ".raw");
+		data_ = fopen(data_path.c_str(), "wb");
+		index_ = fopen((base + ".idx").c_str(), "w");
+		if (!data_ || !index_) {
+			std::cerr << "Could not create " << data_path
+				  << std::endl;
+			return false;
+		}
+
+		frame_bytes_ = params.layout.total_size;
+		if (v210_) {
+			if (!packer_.allocate(params.layout))
+				return false;
+			frame_bytes_ = packer_.frame_bytes();
+		}
+		char name[5];
+		fprintf(index_, "# %s %dx%d %d/%d %zu\n",
+			v210_ ? "V210" : fourcc_name(fourcc, name),
+			params.layout.xres, params.layout.yres,
+			params.frame_rate_N, params.frame_rate_D,
+			frame_bytes_);
+		std::cout << "Writing frames to " << data_path << std::endl;
+		return true;
+	}
+
+	void send_video(const NDIlib_video_frame_v2_t &frame) override
+	{
+		fprintf(index_, "%llu %llu %lld\n",
+			(unsigned long long)frames_,
+			(unsigned long long)(frames_ * frame_bytes_),
+			(long long)frame.timestamp);
+		fwrite(v210_ ? packer_.pack(frame) : frame.p_data, 1,
+		       frame_bytes_, data_);
+		++frames_;
+	}
+	void send_audio(const NDIlib_audio_frame_v2_t &) override {}
+
+	const char *type_name() const override { return "file"; }
+
+private:
+	std::string folder_;
+	FILE *data_;
+	FILE *index_;
+	size_t frame_bytes_;
+	uint64_t frames_;
+	bool v210_;
+	V210Packer packer_;
+};
+
+std::unique_ptr<FrameSink> create_frame_sink(SinkType type,
+					     const std::string &folder)
+{
+	switch (type) {
+	case SinkType::Null:
+		return std::unique_ptr<FrameSink>(new NullSink());
+	case SinkType::RawFile:
+		return std::unique_ptr<FrameSink>(new RawFileSink(folder));
+	case SinkType::Ndi:
+	default:
+#ifdef SYNCTEST_NO_NDI
+		return nullptr;
+#else
+		return std::unique_ptr<FrameSink>(new NdiSink());
+#endif
+	}
+}
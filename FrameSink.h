@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <Processing.NDI.Lib.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "FrameLayout.h"
+
+// Where a stream's frames go
+enum class SinkType {
+	Ndi,    // NDI sender on the network
+	Null,   // discard, for benchmarking the generator
+	RawFile // append frames to a .yuv/.raw file with an index
+};
+
+// Parse "ndi", "null" or "file". Returns false for anything else.
+bool parse_sink_type(const char *name, SinkType &type);
+
+// What a sink needs to know about the stream it receives
+struct SinkParams {
+	std::string name;      // NDI source name
+	std::string file_name; // file name base for the file sink
+	FrameLayout layout;
+	int frame_rate_N;
+	int frame_rate_D;
+	bool clock_video; // let the sink pace video at the frame rate
+	bool v210;        // P216 frames stand for V210 (see is_v210_format)
+};
+
+// Destination of one stream's video and audio frames
+class FrameSink {
+public:
+	virtual ~FrameSink() {}
+
+	// Returns false if the sink cannot be opened
+	virtual bool open(const SinkParams &params) = 0;
+
+	virtual void send_video(const NDIlib_video_frame_v2_t &frame) = 0;
+	// The sink may read frame's buffer until the next video send or a
+	// nullptr flush. Sinks that copy or drop frames at once send them
+	// synchronously.
+	virtual void send_video_async(const NDIlib_video_frame_v2_t *frame)
+	{
+		if (frame)
+			send_video(*frame);
+	}
+	virtual void send_audio(const NDIlib_audio_frame_v2_t &frame) = 0;
+
+	virtual const char *type_name() const = 0;
+	// Receivers connected to the sink, -1 if it has no such notion
+	virtual int connections() { return -1; }
+};
+
+// Create a sink of type. The file sink writes into folder. Returns nullptr
+// for the NDI sink when built without the NDI SDK (SYNCTEST_NO_NDI).
+std::unique_ptr<FrameSink> create_frame_sink(SinkType type,
+					     const std::string &folder);
@@ -0,0 +1,71 @@
+#include "LatencyHistogram.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static inline int floor_log2(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+LatencyHistogram::LatencyHistogram() : total_ns_(0), max_ns_(0)
+{
+	for (auto &count : counts_)
+		count.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::snapshot(uint64_t *counts) const
+{
+	for (int i = 0; i < N_BUCKETS; ++i)
+		counts[i] = counts_[i].load(std::memory_order_relaxed);
+}
+
+int LatencyHistogram::bucket_index(int64_t value_ns)
+{
+	if (value_ns < 2 * SUB_COUNT)
+		return value_ns < 0 ? 0 : (int)value_ns;
+
+	uint64_t value = (uint64_t)value_ns;
+	if (value >= (1ULL << MAX_BITS))
+		value = (1ULL << MAX_BITS) - 1;
+
+	// The top SUB_BITS + 1 bits select the bucket within its power of two
+	const int shift = floor_log2(value) - SUB_BITS;
+	return (shift + 1) * SUB_COUNT + (int)((value >> shift) - SUB_COUNT);
+}
+
+int64_t LatencyHistogram::bucket_value(int index)
+{
+	if (index < 2 * SUB_COUNT)
+		return index;
+
+	const int shift = index / SUB_COUNT - 1;
+	const int64_t low = (int64_t)(index % SUB_COUNT + SUB_COUNT) << shift;
+	return low + ((int64_t)1 << shift) / 2;
+}
+
+int64_t LatencyHistogram::percentile(const uint64_t *counts, uint64_t total,
+				     double percent)
+{
+	if (total == 0)
+		return 0;
+
+	// Smallest bucket that covers at least percent of the values
+	uint64_t rank = (uint64_t)(percent / 100.0 * (double)total + 0.5);
+	if (rank < 1)
+		rank = 1;
+	uint64_t seen = 0;
+	for (int i = 0; i < N_BUCKETS; ++i) {
+		seen += counts[i];
+		if (seen >= rank)
+			return bucket_value(i);
+	}
+	return bucket_value(N_BUCKETS - 1);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Log-linear latency histogram in the style of HdrHistogram.
+//
+// Values up to 64 ns have their own bucket; above that every power of two
+// is split into 32 buckets, so any recorded value is known to within about
+// 3%. Values are clamped at about 36 minutes. The bucket array is fixed, so
+// record() never allocates and costs a few instructions.
+//
+// One thread records; any other thread may read the counts at any time.
+// Counts only ever grow; readers diff two snapshots to get an interval.
+class LatencyHistogram {
+public:
+	static constexpr int SUB_BITS = 5;
+	static constexpr int SUB_COUNT = 1 << SUB_BITS;
+	static constexpr int MAX_BITS = 41; // values below 2^41 ns
+	static constexpr int N_BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+	LatencyHistogram();
+
+	LatencyHistogram(const LatencyHistogram &) = delete;
+	LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+	// Record one value in ns. Called from the single writer thread only.
+	void record(int64_t value_ns)
+	{
+		const int index = bucket_index(value_ns);
+		counts_[index].store(
+			counts_[index].load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+		total_ns_.store(total_ns_.load(std::memory_order_relaxed) +
+					(uint64_t)(value_ns > 0 ? value_ns : 0),
+				std::memory_order_relaxed);
+
+		// Rarely taken; a reader may reset max_ns_ at any time
+		int64_t max = max_ns_.load(std::memory_order_relaxed);
+		while (value_ns > max &&
+		       !max_ns_.compare_exchange_weak(max, value_ns,
+						      std::memory_order_relaxed))
+			;
+	}
+
+	// Copy the cumulative bucket counts (N_BUCKETS entries)
+	void snapshot(uint64_t *counts) const;
+	uint64_t total_ns() const
+	{
+		return total_ns_.load(std::memory_order_relaxed);
+	}
+	// Largest value since the last take_max() (exact, not bucketed)
+	int64_t take_max() { return max_ns_.exchange(0); }
+
+	static int bucket_index(int64_t value_ns);
+	// Representative value of a bucket: the middle of its range
+	static int64_t bucket_value(int index);
+
+	// Value at percentile (0..100) of an interval histogram
+	static int64_t percentile(const uint64_t *counts, uint64_t total,
+				  double percent);
+
+private:
+	std::atomic<uint64_t> counts_[N_BUCKETS];
+	std::atomic<uint64_t> total_ns_;
+	std::atomic<int64_t> max_ns_;
+};
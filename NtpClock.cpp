@@ -0,0 +1,240 @@
+#include "NtpClock.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include "PlatformTime.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#define INVALID_SOCKET (-1)
+#define closesocket close
+typedef int SOCKET;
+#endif
+
+// NTP packet (48 bytes), all fields in network byte order
+struct NtpPacket {
+	uint8_t li_vn_mode;
+	uint8_t stratum;
+	uint8_t poll;
+	uint8_t precision;
+	uint32_t root_delay;
+	uint32_t root_dispersion;
+	uint32_t ref_id;
+	uint32_t ref_s;
+	uint32_t ref_f;
+	uint32_t orig_s;
+	uint32_t orig_f;
+	uint32_t rx_s; // server receive time
+	uint32_t rx_f;
+	uint32_t tx_s; // server transmit time
+	uint32_t tx_f;
+};
+
+static const int64_t ntp_unix_delta = 2208988800LL;
+static const int64_t ns_per_sec = 1000000000LL;
+
+// NTP seconds and 1/2^32 fractions to ns since the Unix epoch
+static int64_t ntp_to_unix_ns(uint32_t seconds, uint32_t fraction)
+{
+	return ((int64_t)ntohl(seconds) - ntp_unix_delta) * ns_per_sec +
+	       (int64_t)(((uint64_t)ntohl(fraction) * ns_per_sec) >> 32);
+}
+
+NtpClock::NtpClock()
+	: start_time_(0),
+	  start_local_ns_(0),
+	  stop_(false),
+	  synced_(false),
+	  slew_start_ns_(0),
+	  slew_from_(0),
+	  target_(0)
+{
+}
+
+NtpClock::~NtpClock()
+{
+	stop();
+}
+
+void NtpClock::start(const std::string &server, int64_t start_time,
+		     uint64_t start_local_ns)
+{
+	server_ = server;
+	start_time_ = start_time;
+	start_local_ns_ = start_local_ns;
+	stop_ = false;
+	thread_ = std::thread(&NtpClock::run, this);
+}
+
+void NtpClock::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	cv_.notify_all();
+	if (thread_.joinable())
+		thread_.join();
+}
+
+int64_t NtpClock::slewed(uint64_t now_ns) const
+{
+	const int64_t elapsed = (int64_t)(now_ns - slew_start_ns_);
+	const int64_t max_step =
+		elapsed <= 0 ? 0 : elapsed / 1000000 * MAX_SLEW_PPM;
+	const int64_t error = target_ - slew_from_;
+	return slew_from_ + std::max(-max_step, std::min(max_step, error));
+}
+
+int64_t NtpClock::correction_ns(uint64_t now_ns) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return slewed(now_ns);
+}
+
+bool NtpClock::synced() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return synced_;
+}
+
+void NtpClock::run()
+{
+#ifdef _WIN32
+	WSADATA wsa_data;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+		std::cerr << "NTP: WSAStartup failed" << std::endl;
+		return;
+	}
+#endif
+
+	int retry_seconds = 1;
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (!stop_) {
+		lock.unlock();
+		int64_t offset = 0;
+		int64_t delay = 0;
+		const bool ok = measure(offset, delay);
+		const uint64_t now = os_gettime_ns();
+		lock.lock();
+
+		int wait_seconds = RESYNC_SECONDS;
+		if (ok) {
+			if (!synced_)
+				std::cout << "NTP: first answer, streams now "
+					     "slew to NTP time"
+					  << std::endl;
+			// Slew on from wherever the correction is now
+			slew_from_ = slewed(now);
+			slew_start_ns_ = now;
+			target_ = offset;
+			synced_ = true;
+			retry_seconds = 1;
+			std::cout << "NTP: " << server_ << " offset "
+				  << offset / 1000 << " us, round trip "
+				  << delay / 1000 << " us" << std::endl;
+		} else {
+			wait_seconds = retry_seconds;
+			retry_seconds = std::min(retry_seconds * 2,
+						 MAX_RETRY_SECONDS);
+		}
+		cv_.wait_for(lock, std::chrono::seconds(wait_seconds),
+			     [this] { return stop_; });
+	}
+	lock.unlock();
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+bool NtpClock::measure(int64_t &offset_ns, int64_t &delay_ns)
+{
+	// Keep the answer with the shortest round trip; its offset has the
+	// smallest error bound
+	bool any = false;
+	for (int i = 0; i < BURST; ++i) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (stop_)
+				break;
+		}
+		int64_t offset = 0;
+		int64_t delay = 0;
+		if (!query(offset, delay))
+			continue;
+		if (!any || delay < delay_ns) {
+			offset_ns = offset;
+			delay_ns = delay;
+		}
+		any = true;
+	}
+	return any;
+}
+
+bool NtpClock::query(int64_t &offset_ns, int64_t &delay_ns)
+{
+	addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_protocol = IPPROTO_UDP;
+	addrinfo *result = nullptr;
+	if (getaddrinfo(server_.c_str(), "123", &hints, &result) != 0)
+		return false;
+
+	SOCKET sockfd = socket(result->ai_family, result->ai_socktype,
+			       result->ai_protocol);
+	if (sockfd == INVALID_SOCKET) {
+		freeaddrinfo(result);
+		return false;
+	}
+#ifdef _WIN32
+	DWORD timeout = TIMEOUT_MS;
+#else
+	timeval timeout = {TIMEOUT_MS / 1000, (TIMEOUT_MS % 1000) * 1000};
+#endif
+	setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout,
+		   sizeof(timeout));
+
+	NtpPacket packet = {};
+	packet.li_vn_mode = 0x1B; // LI = 0, VN = 3, Mode = 3 (client)
+
+	const uint64_t t0 = os_gettime_ns();
+	const int sent = sendto(sockfd, (const char *)&packet, sizeof(packet),
+				0, result->ai_addr, (int)result->ai_addrlen);
+	freeaddrinfo(result);
+	NtpPacket response = {};
+	const int received =
+		sent == (int)sizeof(packet)
+			? recv(sockfd, (char *)&response, sizeof(response), 0)
+			: -1;
+	const uint64_t t3 = os_gettime_ns();
+	closesocket(sockfd);
+	if (received < (int)sizeof(response) || response.tx_s == 0)
+		return false;
+
+	// Only a server reply (mode 4) from a synchronized server carries
+	// usable times: LI 3 is an unsynchronized clock, stratum 0 a
+	// kiss-o'-death packet
+	const int leap = response.li_vn_mode >> 6;
+	if ((response.li_vn_mode & 7) != 4 || leap == 3 ||
+	    response.stratum == 0)
+		return false;
+
+	// Standard NTP offset and delay, against stream time
+	const int64_t t1 = ntp_to_unix_ns(response.rx_s, response.rx_f);
+	const int64_t t2 = ntp_to_unix_ns(response.tx_s, response.tx_f);
+	const int64_t s0 = stream_time(t0);
+	const int64_t s3 = stream_time(t3);
+	offset_ns = ((t1 - s0) + (t2 - s3)) / 2;
+	delay_ns = (s3 - s0) - (t2 - t1);
+	return true;
+}
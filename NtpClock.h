@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Aligns stream time with NTP without holding up the first frame.
+//
+// Streams start on a local estimate of wall-clock time. A background thread
+// queries the NTP server (a burst of requests, keeping the one with the
+// shortest round trip), retries with backoff when the server does not
+// answer, and re-syncs periodically. Each new measurement becomes the target
+// of a correction that streams add to their times; the correction moves
+// toward its target at no more than MAX_SLEW_PPM, so timestamps never jump.
+class NtpClock {
+public:
+	static constexpr int64_t MAX_SLEW_PPM = 1000; // 1 ms per second
+	static constexpr int BURST = 4;               // requests per sync
+	static constexpr int TIMEOUT_MS = 1000;       // per request
+	static constexpr int RESYNC_SECONDS = 64;
+	static constexpr int MAX_RETRY_SECONDS = 32;
+
+	NtpClock();
+	~NtpClock();
+
+	NtpClock(const NtpClock &) = delete;
+	NtpClock &operator=(const NtpClock &) = delete;
+
+	// Start syncing with server. Streams run on start_time (ns since the
+	// Unix epoch) at start_local_ns (os_gettime_ns time), advancing with
+	// os_gettime_ns from there.
+	void start(const std::string &server, int64_t start_time,
+		   uint64_t start_local_ns);
+	// Stop the background thread
+	void stop();
+
+	// Correction to add to stream time at now_ns (os_gettime_ns time)
+	int64_t correction_ns(uint64_t now_ns) const;
+	// True once a measurement has arrived
+	bool synced() const;
+
+private:
+	void run();
+	// One burst of requests. Returns false if none was answered.
+	bool measure(int64_t &offset_ns, int64_t &delay_ns);
+	bool query(int64_t &offset_ns, int64_t &delay_ns);
+	int64_t stream_time(uint64_t local_ns) const
+	{
+		return start_time_ + (int64_t)(local_ns - start_local_ns_);
+	}
+	int64_t slewed(uint64_t now_ns) const;
+
+	std::string server_;
+	int64_t start_time_;
+	uint64_t start_local_ns_;
+
+	// Correction slews from slew_from_ at slew_start_ns_ toward target_
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;
+	bool stop_;
+	bool synced_;
+	uint64_t slew_start_ns_;
+	int64_t slew_from_;
+	int64_t target_;
+	std::thread thread_;
+};
@@ -0,0 +1,58 @@
+#include "PatternRenderer.h"
+#include <cctype>
+#include <string>
+
+bool parse_named_color(const char *arg, NamedColor &color)
+{
+	std::string name(arg ? arg : "");
+	// normalize to lower-case
+	std::transform(name.begin(), name.end(), name.begin(),
+		       [](unsigned char c) { return std::tolower(c); });
+
+	if (name == "white")
+		color = NamedColor::White;
+	else if (name == "blue")
+		color = NamedColor::Blue;
+	else if (name == "green")
+		color = NamedColor::Green;
+	else if (name == "red")
+		color = NamedColor::Red;
+	else
+		return false;
+	return true;
+}
+
+template <NDIlib_FourCC_video_type_e FourCC>
+static PatternColors colors_for(NamedColor move)
+{
+	typedef FormatTraits<FourCC> Traits;
+	PatternColors colors;
+	colors.white = Traits::white;
+	colors.black = Traits::black;
+	colors.move = Traits::named(move);
+	return colors;
+}
+
+PatternColors get_pattern_colors(NDIlib_FourCC_video_type_e fourcc,
+				 NamedColor move)
+{
+	switch (fourcc) {
+	case NDIlib_FourCC_type_UYVA:
+		return colors_for<NDIlib_FourCC_type_UYVA>(move);
+	case NDIlib_FourCC_type_BGRA:
+		return colors_for<NDIlib_FourCC_type_BGRA>(move);
+	case NDIlib_FourCC_type_BGRX:
+		return colors_for<NDIlib_FourCC_type_BGRX>(move);
+	case NDIlib_FourCC_type_RGBA:
+		return colors_for<NDIlib_FourCC_type_RGBA>(move);
+	case NDIlib_FourCC_type_RGBX:
+		return colors_for<NDIlib_FourCC_type_RGBX>(move);
+	case NDIlib_FourCC_type_P216:
+		return colors_for<NDIlib_FourCC_type_P216>(move);
+	case NDIlib_FourCC_type_PA16:
+		return colors_for<NDIlib_FourCC_type_PA16>(move);
+	case NDIlib_FourCC_type_UYVY:
+	default:
+		return colors_for<NDIlib_FourCC_type_UYVY>(move);
+	}
+}
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include "FillKernels.h"
+#include "FrameLayout.h"
+
+// Compile-time description of each FourCC, and pattern renderers
+// specialized per (FourCC, pattern). Every specialization is instantiated
+// once; select_pattern_renderer() returns the one for a stream's format at
+// startup, so the send loop calls a single function pointer and never
+// branches on the format.
+//
+// Colors are passed around packed the way get_pattern_colors() returns
+// them: U | Y << 8 (| A << 24) for UYVY/UYVA, 10-bit U | Y << 10 | A << 20
+// for P216/PA16, and the pixel itself as a little-endian 32-bit word for
+// the RGB formats.
+
+enum class NamedColor { White, Blue, Green, Red };
+
+// Parse white, blue, green or red, ignoring case
+bool parse_named_color(const char *arg, NamedColor &color);
+
+// Packed colors of a stream: the white and black frames and the Move box
+struct PatternColors {
+	uint32_t white;
+	uint32_t black;
+	uint32_t move;
+};
+PatternColors get_pattern_colors(NDIlib_FourCC_video_type_e fourcc,
+				 NamedColor move);
+
+template <NDIlib_FourCC_video_type_e FourCC> struct FormatTraits;
+
+// 8-bit 4:2:2, memory layout per 2 pixels: U0 Y0 V0 Y1
+struct UyvyTraitsBase {
+	static constexpr bool semi_planar16 = false;
+	static constexpr int bytes_per_pixel = 2;
+	static constexpr int pixel_align = 2; // U and V are shared by a pair
+	static constexpr uint32_t white = 128 | (235 << 8);
+	static constexpr uint32_t black = 128 | (16 << 8);
+
+	static constexpr uint32_t word(uint32_t color)
+	{
+		// Neutral chroma: V = U
+		return (color & 0xFF) | (color & 0xFF00) |
+		       ((color & 0xFF) << 16) | ((color & 0xFF00) << 16);
+	}
+	// Approximate Move colors as (U, Y): blue (90, 41), green (43, 182),
+	// red (84, 76)
+	static constexpr uint32_t named(NamedColor color)
+	{
+		return color == NamedColor::Blue    ? (90u | (41u << 8))
+		       : color == NamedColor::Green ? (43u | (182u << 8))
+		       : color == NamedColor::Red   ? (84u | (76u << 8))
+						    : white;
+	}
+};
+
+template <>
+struct FormatTraits<NDIlib_FourCC_type_UYVY> : UyvyTraitsBase {
+	static constexpr bool alpha_plane = false;
+};
+
+// UYVY plane followed by a plane of one alpha byte per pixel
+template <>
+struct FormatTraits<NDIlib_FourCC_type_UYVA> : UyvyTraitsBase {
+	static constexpr bool alpha_plane = true;
+	// Fully opaque so white appears white when composited
+	static constexpr uint32_t white = UyvyTraitsBase::white | (255u << 24);
+	static constexpr uint32_t black = UyvyTraitsBase::black | (255u << 24);
+
+	static constexpr uint32_t named(NamedColor color)
+	{
+		return UyvyTraitsBase::named(color) | (255u << 24);
+	}
+};
+
+// 16-bit semi-planar 4:2:2 with 10-bit samples in the top bits of each
+// 16-bit word: a Y plane, then a plane of Cb, Cr pairs. Every plane repeats
+// a 32-bit word along a row, like the packed formats.
+struct P216TraitsBase {
+	static constexpr bool semi_planar16 = true;
+	static constexpr int bytes_per_pixel = 2; // in each plane
+	static constexpr int pixel_align = 2;     // Cb, Cr shared by a pair
+	static constexpr uint32_t white = 512 | (940 << 10);
+	static constexpr uint32_t black = 512 | (64 << 10);
+
+	static constexpr uint32_t pair(uint32_t sample10)
+	{
+		return ((sample10 & 0x3FF) << 6) * 0x10001u;
+	}
+	static constexpr uint32_t y_word(uint32_t color)
+	{
+		return pair(color >> 10);
+	}
+	// Neutral chroma: Cr = Cb
+	static constexpr uint32_t uv_word(uint32_t color)
+	{
+		return pair(color);
+	}
+	static constexpr uint32_t alpha_word(uint32_t color)
+	{
+		return pair(color >> 20);
+	}
+	// The 8-bit Move colors scaled to 10 bits
+	static constexpr uint32_t named(NamedColor color)
+	{
+		return color == NamedColor::Blue    ? (360u | (164u << 10))
+		       : color == NamedColor::Green ? (172u | (728u << 10))
+		       : color == NamedColor::Red   ? (336u | (304u << 10))
+						    : white;
+	}
+};
+
+template <>
+struct FormatTraits<NDIlib_FourCC_type_P216> : P216TraitsBase {
+	static constexpr bool alpha_plane = false;
+};
+
+// P216 followed by a plane of one 16-bit alpha sample per pixel
+template <>
+struct FormatTraits<NDIlib_FourCC_type_PA16> : P216TraitsBase {
+	static constexpr bool alpha_plane = true;
+	static constexpr uint32_t white = P216TraitsBase::white | (1023u << 20);
+	static constexpr uint32_t black = P216TraitsBase::black | (1023u << 20);
+
+	static constexpr uint32_t named(NamedColor color)
+	{
+		return P216TraitsBase::named(color) | (1023u << 20);
+	}
+};
+
+// 32-bit packed RGB; the shifts place each channel in the little-endian word
+template <int RShift, int GShift, int BShift> struct Rgb32Traits {
+	static constexpr bool semi_planar16 = false;
+	static constexpr int bytes_per_pixel = 4;
+	static constexpr int pixel_align = 1;
+	static constexpr bool alpha_plane = false;
+	static constexpr uint32_t white = 0xFFFFFFFF;
+	static constexpr uint32_t black = 0x00000000;
+
+	static constexpr uint32_t word(uint32_t color) { return color; }
+	static constexpr uint32_t rgb(uint32_t r, uint32_t g, uint32_t b)
+	{
+		return (255u << 24) | (r << RShift) | (g << GShift) |
+		       (b << BShift);
+	}
+	static constexpr uint32_t named(NamedColor color)
+	{
+		return color == NamedColor::Blue    ? rgb(0, 0, 255)
+		       : color == NamedColor::Green ? rgb(0, 255, 0)
+		       : color == NamedColor::Red   ? rgb(255, 0, 0)
+						    : white;
+	}
+};
+
+template <>
+struct FormatTraits<NDIlib_FourCC_type_BGRA> : Rgb32Traits<16, 8, 0> {};
+template <>
+struct FormatTraits<NDIlib_FourCC_type_BGRX> : Rgb32Traits<16, 8, 0> {};
+template <>
+struct FormatTraits<NDIlib_FourCC_type_RGBA> : Rgb32Traits<0, 8, 16> {};
+template <>
+struct FormatTraits<NDIlib_FourCC_type_RGBX> : Rgb32Traits<0, 8, 16> {};
+
+// What to draw. Renderers draw the part of it in rows [first_row, last_row)
+// so a frame can be split into bands.
+struct PatternParams {
+	uint32_t color;
+	int x, y, w, h; // box patterns only
+};
+
+typedef void (*PatternRenderFn)(const FrameLayout &layout, uint8_t *p_data,
+				const PatternParams &params, int first_row,
+				int last_row);
+
+// The whole frame in one color
+struct SolidPattern {};
+// A rectangle in one color, clipped to the frame and widened to whole
+// chroma pairs on 4:2:2
+struct BoxPattern {};
+
+enum class PatternType { Solid, Box };
+
+template <NDIlib_FourCC_video_type_e FourCC, typename Pattern>
+struct PatternRenderer;
+
+template <NDIlib_FourCC_video_type_e FourCC>
+struct PatternRenderer<FourCC, SolidPattern> {
+	typedef FormatTraits<FourCC> Traits;
+
+	static void render(const FrameLayout &layout, uint8_t *p_data,
+			   const PatternParams &params, int first_row,
+			   int last_row)
+	{
+		// Whole frames are not read back soon; keep them out of cache
+		const bool stream = layout.total_size >= FILL_STREAM_THRESHOLD;
+		auto fill = stream ? fill_pattern32_stream : fill_pattern32;
+
+		// Rows of every plane are contiguous, so a band is one span
+		// per plane
+		const size_t rows = (size_t)(last_row - first_row);
+		const size_t row_bytes =
+			(size_t)layout.xres * Traits::bytes_per_pixel;
+		if constexpr (Traits::semi_planar16) {
+			const size_t plane = row_bytes * layout.yres;
+			uint8_t *p_band = p_data + first_row * row_bytes;
+			fill(p_band, rows * row_bytes,
+			     Traits::y_word(params.color));
+			fill(p_band + plane, rows * row_bytes,
+			     Traits::uv_word(params.color));
+			if (Traits::alpha_plane)
+				fill(p_band + 2 * plane, rows * row_bytes,
+				     Traits::alpha_word(params.color));
+		} else {
+			fill(p_data + first_row * row_bytes, rows * row_bytes,
+			     Traits::word(params.color));
+			if (Traits::alpha_plane)
+				fill(p_data + layout.plane1_size +
+					     (size_t)first_row * layout.xres,
+				     rows * layout.xres,
+				     (params.color >> 24) * 0x01010101u);
+		}
+	}
+};
+
+template <NDIlib_FourCC_video_type_e FourCC>
+struct PatternRenderer<FourCC, BoxPattern> {
+	typedef FormatTraits<FourCC> Traits;
+
+	static void render(const FrameLayout &layout, uint8_t *p_data,
+			   const PatternParams &params, int first_row,
+			   int last_row)
+	{
+		const int align = Traits::pixel_align;
+		const int x = std::max(params.x, 0) / align * align;
+		const int x1 = std::min((params.x + params.w + align - 1) /
+						align * align,
+					layout.xres);
+		const int y = std::max(params.y, first_row);
+		const int y1 = std::min(params.y + params.h, last_row);
+		if (x >= x1 || y >= y1)
+			return;
+
+		const size_t row_bytes =
+			(size_t)layout.xres * Traits::bytes_per_pixel;
+		const size_t width = (size_t)(x1 - x);
+		if constexpr (Traits::semi_planar16) {
+			// The same span of every plane; Cb, Cr pairs line up
+			// with pixel pairs
+			const size_t plane = row_bytes * layout.yres;
+			const size_t span = width * Traits::bytes_per_pixel;
+			const uint32_t y_word = Traits::y_word(params.color);
+			const uint32_t uv_word = Traits::uv_word(params.color);
+			const uint32_t a_word =
+				Traits::alpha_word(params.color);
+			uint8_t *dst = p_data + y * row_bytes +
+				       (size_t)x * Traits::bytes_per_pixel;
+			for (int row = y; row < y1; ++row, dst += row_bytes) {
+				fill_pattern32(dst, span, y_word);
+				fill_pattern32(dst + plane, span, uv_word);
+				if (Traits::alpha_plane)
+					fill_pattern32(dst + 2 * plane, span,
+						       a_word);
+			}
+		} else {
+			const uint32_t word = Traits::word(params.color);
+			uint8_t *dst = p_data + y * row_bytes +
+				       (size_t)x * Traits::bytes_per_pixel;
+			for (int row = y; row < y1; ++row, dst += row_bytes)
+				fill_pattern32(dst,
+					       width * Traits::bytes_per_pixel,
+					       word);
+
+			if (Traits::alpha_plane) {
+				const uint32_t alpha =
+					(params.color >> 24) * 0x01010101u;
+				uint8_t *plane = p_data + layout.plane1_size +
+						 (size_t)y * layout.xres + x;
+				for (int row = y; row < y1;
+				     ++row, plane += layout.xres)
+					fill_pattern32(plane, width, alpha);
+			}
+		}
+	}
+};
+
+template <typename Pattern>
+inline PatternRenderFn pattern_renderer_for(NDIlib_FourCC_video_type_e fourcc)
+{
+	switch (fourcc) {
+	case NDIlib_FourCC_type_UYVY:
+		return &PatternRenderer<NDIlib_FourCC_type_UYVY,
+					Pattern>::render;
+	case NDIlib_FourCC_type_UYVA:
+		return &PatternRenderer<NDIlib_FourCC_type_UYVA,
+					Pattern>::render;
+	case NDIlib_FourCC_type_BGRA:
+		return &PatternRenderer<NDIlib_FourCC_type_BGRA,
+					Pattern>::render;
+	case NDIlib_FourCC_type_BGRX:
+		return &PatternRenderer<NDIlib_FourCC_type_BGRX,
+					Pattern>::render;
+	case NDIlib_FourCC_type_RGBA:
+		return &PatternRenderer<NDIlib_FourCC_type_RGBA,
+					Pattern>::render;
+	case NDIlib_FourCC_type_RGBX:
+		return &PatternRenderer<NDIlib_FourCC_type_RGBX,
+					Pattern>::render;
+	case NDIlib_FourCC_type_P216:
+		return &PatternRenderer<NDIlib_FourCC_type_P216,
+					Pattern>::render;
+	case NDIlib_FourCC_type_PA16:
+		return &PatternRenderer<NDIlib_FourCC_type_PA16,
+					Pattern>::render;
+	default:
+		return &PatternRenderer<NDIlib_FourCC_type_UYVY,
+					Pattern>::render;
+	}
+}
+
+// The renderer of a pattern for a format. Call once at startup.
+inline PatternRenderFn select_pattern_renderer(NDIlib_FourCC_video_type_e fourcc,
+					       PatternType type)
+{
+	switch (type) {
+	case PatternType::Box:
+		return pattern_renderer_for<BoxPattern>(fourcc);
+	case PatternType::Solid:
+	default:
+		return pattern_renderer_for<SolidPattern>(fourcc);
+	}
+}
@@ -0,0 +1,169 @@
+#include "PerfReporter.h"
+#include <algorithm>
+#include <chrono>
+#include <json.hpp>
+#include "PerfTimer.h"
+
+// Keep the fields in the order they are set
+using json = nlohmann::ordered_json;
+
+PerfTimer::PerfTimer(const std::string &name) : name_(name), start_ns_(0)
+{
+	PerfReporter::instance().add(this);
+}
+
+PerfTimer::~PerfTimer()
+{
+	PerfReporter::instance().remove(this);
+}
+
+PerfReporter &PerfReporter::instance()
+{
+	static PerfReporter reporter;
+	return reporter;
+}
+
+PerfReporter::PerfReporter()
+	: stop_(false), format_(PerfFormat::Json), interval_ms_(0), out_(nullptr)
+{
+}
+
+PerfReporter::~PerfReporter()
+{
+	stop();
+}
+
+void PerfReporter::add(PerfTimer *timer)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	Entry entry;
+	entry.timer = timer;
+	entry.last_counts.assign(LatencyHistogram::N_BUCKETS, 0);
+	entry.last_total_ns = 0;
+	entries_.push_back(std::move(entry));
+}
+
+void PerfReporter::remove(PerfTimer *timer)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+				      [timer](const Entry &entry) {
+					      return entry.timer == timer;
+				      }),
+		       entries_.end());
+}
+
+bool PerfReporter::start(PerfFormat format, int interval_ms,
+			 const std::string &path)
+{
+	stop();
+
+	FILE *out = stdout;
+	if (!path.empty()) {
+		out = fopen(path.c_str(), "w");
+		if (!out)
+			return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	format_ = format;
+	interval_ms_ = std::max(1, interval_ms);
+	out_ = out;
+	stop_ = false;
+	counts_.assign(LatencyHistogram::N_BUCKETS, 0);
+	interval_.assign(LatencyHistogram::N_BUCKETS, 0);
+	if (format_ == PerfFormat::Csv)
+		fprintf(out_, "time_ns,timer,count,mean_ns,p50_ns,p90_ns,"
+			      "p99_ns,p99_9_ns,max_ns\n");
+	thread_ = std::thread(&PerfReporter::run, this);
+	return true;
+}
+
+void PerfReporter::stop()
+{
+	if (!thread_.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	cv_.notify_all();
+	thread_.join();
+
+	if (out_ && out_ != stdout)
+		fclose(out_);
+	out_ = nullptr;
+}
+
+void PerfReporter::run()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto next = std::chrono::steady_clock::now() +
+		    std::chrono::milliseconds(interval_ms_);
+	for (;;) {
+		const bool stopping = cv_.wait_until(
+			lock, next, [this] { return stop_; });
+		report(os_gettime_ns());
+		if (stopping)
+			return;
+		next += std::chrono::milliseconds(interval_ms_);
+	}
+}
+
+void PerfReporter::report(uint64_t now_ns)
+{
+	for (Entry &entry : entries_) {
+		LatencyHistogram &histogram = entry.timer->histogram();
+
+		// Counts only grow, so the interval is the difference to the
+		// previous snapshot
+		histogram.snapshot(counts_.data());
+		const uint64_t total_ns = histogram.total_ns();
+		uint64_t count = 0;
+		for (int i = 0; i < LatencyHistogram::N_BUCKETS; ++i) {
+			interval_[i] = counts_[i] - entry.last_counts[i];
+			count += interval_[i];
+		}
+		entry.last_counts.swap(counts_);
+		const uint64_t sum_ns = total_ns - entry.last_total_ns;
+		entry.last_total_ns = total_ns;
+		const int64_t max_ns = histogram.take_max();
+		if (count == 0)
+			continue;
+
+		// Bucket midpoints can overshoot the exact max in the top bucket
+		const double mean_ns = (double)sum_ns / (double)count;
+		auto percentile = [&](double percent) {
+			return std::min(max_ns, LatencyHistogram::percentile(
+							interval_.data(), count,
+							percent));
+		};
+		const int64_t p50 = percentile(50.0);
+		const int64_t p90 = percentile(90.0);
+		const int64_t p99 = percentile(99.0);
+		const int64_t p999 = percentile(99.9);
+
+		if (format_ == PerfFormat::Csv) {
+			fprintf(out_,
+				"%llu,\"%s\",%llu,%.0f,%lld,%lld,%lld,%lld,%lld\n",
+				(unsigned long long)now_ns,
+				entry.timer->name().c_str(),
+				(unsigned long long)count, mean_ns,
+				(long long)p50, (long long)p90, (long long)p99,
+				(long long)p999, (long long)max_ns);
+		} else {
+			json line;
+			line["time_ns"] = now_ns;
+			line["timer"] = entry.timer->name();
+			line["count"] = count;
+			line["mean_ns"] = (int64_t)mean_ns;
+			line["p50_ns"] = p50;
+			line["p90_ns"] = p90;
+			line["p99_ns"] = p99;
+			line["p99_9_ns"] = p999;
+			line["max_ns"] = max_ns;
+			fprintf(out_, "%s\n", line.dump().c_str());
+		}
+	}
+	fflush(out_);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class PerfTimer;
+
+enum class PerfFormat { Json, Csv };
+
+// Background thread that reports every PerfTimer once per interval:
+// count, mean, p50/p90/p99/p99.9 and max of the values recorded since the
+// previous report, one JSON object or CSV row per timer. All formatting and
+// I/O happens on this thread, never in the timed loops.
+class PerfReporter {
+public:
+	// The process-wide reporter that PerfTimers register with
+	static PerfReporter &instance();
+
+	void add(PerfTimer *timer);
+	void remove(PerfTimer *timer);
+
+	// Start reporting every interval_ms to path, or to stdout if path is
+	// empty. Returns false if the file cannot be opened.
+	bool start(PerfFormat format, int interval_ms, const std::string &path);
+	// Report the final interval and stop the thread
+	void stop();
+
+private:
+	PerfReporter();
+	~PerfReporter();
+
+	struct Entry {
+		PerfTimer *timer;
+		std::vector<uint64_t> last_counts;
+		uint64_t last_total_ns;
+	};
+
+	void run();
+	void report(uint64_t now_ns);
+
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::vector<Entry> entries_;
+	std::vector<uint64_t> counts_; // scratch snapshot
+	std::vector<uint64_t> interval_;
+	std::thread thread_;
+	bool stop_;
+	PerfFormat format_;
+	int interval_ms_;
+	FILE *out_;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include "LatencyHistogram.h"
+#include "PlatformTime.h"
+
+// Times a section of the send loop into a latency histogram. Nothing is
+// printed from the timed thread: the PerfReporter thread reports every
+// registered timer's percentiles in the background.
+class PerfTimer {
+public:
+	explicit PerfTimer(const std::string &name);
+	~PerfTimer();
+
+	PerfTimer(const PerfTimer &) = delete;
+	PerfTimer &operator=(const PerfTimer &) = delete;
+
+	void start() { start_ns_ = os_gettime_ns(); }
+	void end() { histogram_.record((int64_t)(os_gettime_ns() - start_ns_)); }
+
+	const std::string &name() const { return name_; }
+	LatencyHistogram &histogram() { return histogram_; }
+	const LatencyHistogram &histogram() const { return histogram_; }
+
+private:
+	const std::string name_;
+	uint64_t start_ns_;
+	LatencyHistogram histogram_;
+};
@@ -0,0 +1,49 @@
+#include "PlatformTime.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+	defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+static bool have_clockfreq = false;
+static LARGE_INTEGER clock_freq;
+
+static inline uint64_t get_clockfreq(void)
+{
+	if (!have_clockfreq) {
+		QueryPerformanceFrequency(&clock_freq);
+		have_clockfreq = true;
+	}
+
+	return clock_freq.QuadPart;
+}
+
+uint64_t os_gettime_ns(void)
+{
+	LARGE_INTEGER current_time;
+	QueryPerformanceCounter(&current_time);
+	return util_mul_div64(current_time.QuadPart, 1000000000,
+			      get_clockfreq());
+}
+#else
+uint64_t os_gettime_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+void os_cpu_relax(void)
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+	defined(__i386__)
+	_mm_pause();
+#endif
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// num * mul / div without overflowing the intermediate product
+static inline uint64_t util_mul_div64(uint64_t num, uint64_t mul, uint64_t div)
+{
+#if defined(_MSC_VER) && defined(_M_X64) && (_MSC_VER >= 1920)
+	unsigned __int64 high;
+	const unsigned __int64 low = _umul128(num, mul, &high);
+	unsigned __int64 rem;
+	return _udiv128(high, low, div, &rem);
+#elif defined(__SIZEOF_INT128__)
+	return (uint64_t)((unsigned __int128)num * mul / div);
+#else
+	const uint64_t rem = num % div;
+	return (num / div) * mul + (rem * mul) / div;
+#endif
+}
+
+// Monotonic time in nanoseconds (QueryPerformanceCounter on Windows)
+uint64_t os_gettime_ns(void);
+
+// Hint to the CPU that we are in a spin-wait loop
+void os_cpu_relax(void);
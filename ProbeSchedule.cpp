@@ -0,0 +1,98 @@
+#include "ProbeSchedule.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <utility>
+
+static const uint64_t ns_per_ms = 1000000ULL;
+
+ProbeSchedule::ProbeSchedule()
+	: origin_frame_(0), cycle_frames_(1), flashes_(0)
+{
+}
+
+void ProbeSchedule::build(const ProbeParams &params, const Timebase &timebase,
+			  uint64_t origin_ns)
+{
+	const uint64_t period_ms = (uint64_t)std::max(params.period_ms, 1);
+	const uint64_t on_ms = (uint64_t)std::max(params.on_ms, 1);
+	const uint64_t burst = (uint64_t)std::max(params.burst, 1);
+	const uint64_t gap_ms = (uint64_t)std::max(params.burst_gap_ms, 0);
+	// A burst must fit its period, and the jitter what is left of it
+	const uint64_t burst_ms =
+		std::min(burst * on_ms + (burst - 1) * gap_ms, period_ms);
+	const uint64_t jitter_ms =
+		std::min((uint64_t)std::max(params.jitter_ms, 0),
+			 period_ms - burst_ms);
+
+	// A period is period * N / (D * 1000) frames at N/D fps, so whole
+	// periods and whole frames line up every period * N / gcd(period * N,
+	// D * 1000) frames: 4 s at 30 fps is one period of 120 frames, at
+	// 29.97 it is 1001 periods of 120000 frames in all.
+	const uint64_t period_ns = period_ms * ns_per_ms;
+	const uint64_t rate_N = timebase.rate_N();
+	const uint64_t rate_D = timebase.rate_D() * 1000;
+	const uint64_t g = std::gcd(period_ms * rate_N, rate_D);
+	uint64_t periods = rate_D / g;
+	uint64_t cycle_frames = period_ms * rate_N / g;
+	if (cycle_frames > MAX_CYCLE_FRAMES) {
+		// No short exact cycle: repeat every period rounded to frames,
+		// which drifts from the wall clock by under a frame per period
+		periods = 1;
+		cycle_frames = std::max<uint64_t>(
+			1, (period_ms * rate_N + rate_D / 2) / rate_D);
+	}
+	// Jitter repeats with the cycle; make that rare
+	if (jitter_ms > 0) {
+		const uint64_t cycle_ms = periods * period_ms;
+		const uint64_t repeats =
+			(MIN_JITTER_CYCLE_MS + cycle_ms - 1) / cycle_ms;
+		if (cycle_frames * repeats <= MAX_CYCLE_FRAMES) {
+			periods *= repeats;
+			cycle_frames *= repeats;
+		}
+	}
+	const uint64_t cycle_ns = periods * period_ns;
+
+	// Flash intervals of one cycle, in ns from the origin
+	std::vector<std::pair<uint64_t, uint64_t>> intervals;
+	std::mt19937_64 rng(params.seed);
+	std::uniform_int_distribution<uint64_t> jitter(0,
+						       jitter_ms * ns_per_ms);
+	for (uint64_t k = 0; k < periods; ++k) {
+		uint64_t start = k * period_ns;
+		if (jitter_ms > 0)
+			start += jitter(rng);
+		for (uint64_t j = 0; j < burst; ++j) {
+			const uint64_t begin = start + j * (on_ms + gap_ms) *
+							       ns_per_ms;
+			const uint64_t end =
+				std::min(begin + on_ms * ns_per_ms,
+					 start + burst_ms * ns_per_ms);
+			if (begin < end)
+				intervals.emplace_back(begin, end);
+		}
+	}
+	flashes_ = intervals.size();
+
+	// A frame flashes when it starts inside a flash
+	origin_frame_ = timebase.frame_at(origin_ns);
+	cycle_frames_ = cycle_frames;
+	bits_.assign((size_t)((cycle_frames + 63) / 64), 0);
+	for (uint64_t i = 0; i < cycle_frames; ++i) {
+		const uint64_t start =
+			timebase.frame_time_ns(origin_frame_ + i);
+		if (start < origin_ns)
+			continue; // starts before the first period
+		const uint64_t t = (start - origin_ns) % cycle_ns;
+		// The first flash that ends after t
+		auto flash = std::upper_bound(
+			intervals.begin(), intervals.end(), t,
+			[](uint64_t time,
+			   const std::pair<uint64_t, uint64_t> &interval) {
+				return time < interval.second;
+			});
+		if (flash != intervals.end() && flash->first <= t)
+			bits_[i >> 6] |= 1ULL << (i & 63);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Timebase.h"
+
+// When BW mode flashes white with tone. Every period starts a burst of
+// flashes of on_ms each, burst_gap_ms apart. With jitter_ms the burst
+// starts at a random offset of up to jitter_ms into its period, so the
+// onsets do not alias with a receiver that polls at a fixed rate. The
+// defaults are the classic 1 s flash every 4 s.
+struct ProbeParams {
+	int period_ms = 4000;
+	int on_ms = 1000;
+	int jitter_ms = 0;
+	int burst = 1;
+	int burst_gap_ms = 0;
+	uint32_t seed = 1; // streams with the same seed flash together
+};
+
+// A probe schedule precomputed as one bit per frame. The bitmap covers a
+// cycle that is a whole number of both periods and frames, so it repeats
+// exactly and a frame's state is one lookup however long the stream runs.
+class ProbeSchedule {
+public:
+	// Longest cycle kept as a bitmap; odd frame rates fall back to a
+	// cycle of whole periods rounded to frames
+	static constexpr uint64_t MAX_CYCLE_FRAMES = 1 << 24;
+	// Jittered schedules span at least this long before repeating
+	static constexpr uint64_t MIN_JITTER_CYCLE_MS = 10 * 60 * 1000;
+
+	ProbeSchedule();
+
+	// Lay out the schedule in the frames of timebase, with the first
+	// period starting at origin_ns (timebase time)
+	void build(const ProbeParams &params, const Timebase &timebase,
+		   uint64_t origin_ns);
+
+	// Whether frame n of the timebase flashes
+	bool on(uint64_t n) const
+	{
+		if (n < origin_frame_ || bits_.empty())
+			return false;
+		const uint64_t i = (n - origin_frame_) % cycle_frames_;
+		return (bits_[i >> 6] >> (i & 63)) & 1;
+	}
+
+	uint64_t cycle_frames() const { return cycle_frames_; }
+	// Flashes in one cycle
+	uint64_t flashes() const { return flashes_; }
+
+private:
+	uint64_t origin_frame_;
+	uint64_t cycle_frames_;
+	uint64_t flashes_;
+	std::vector<uint64_t> bits_;
+};
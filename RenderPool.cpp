@@ -0,0 +1,99 @@
+#include "RenderPool.h"
+#include <algorithm>
+#include "ThreadScheduling.h"
+
+RenderPool::RenderPool(int threads, bool pin)
+	: generation_(0),
+	  stop_(false),
+	  busy_(0),
+	  render_(nullptr),
+	  rows_(0),
+	  bands_(0),
+	  next_band_(0)
+{
+	for (int i = 0; i < threads; ++i)
+		threads_.emplace_back(&RenderPool::worker, this, pin);
+}
+
+RenderPool::~RenderPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	start_cv_.notify_all();
+	for (auto &thread : threads_)
+		thread.join();
+}
+
+void RenderPool::run(int rows, int bands,
+		     const std::function<void(int, int)> &render)
+{
+	if (bands <= 0)
+		bands = thread_count();
+	bands = std::max(1, std::min(bands, rows));
+	if (bands == 1 || threads_.empty()) {
+		render(0, rows);
+		return;
+	}
+
+	std::lock_guard<std::mutex> run_lock(run_mutex_);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		render_ = &render;
+		rows_ = rows;
+		bands_ = bands;
+		next_band_ = 0;
+		busy_ = (int)threads_.size();
+		++generation_;
+	}
+	start_cv_.notify_all();
+
+	render_bands();
+
+	// Barrier: every worker has left the frame before render goes away
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_cv_.wait(lock, [this] { return busy_ == 0; });
+	render_ = nullptr;
+}
+
+void RenderPool::render_bands()
+{
+	// Bands are claimed dynamically so a slow core does not hold up the
+	// frame; band b covers rows [b * rows / bands, (b + 1) * rows / bands)
+	for (;;) {
+		const int band = next_band_.fetch_add(1);
+		if (band >= bands_)
+			break;
+		const int first = (int)((int64_t)band * rows_ / bands_);
+		const int last = (int)((int64_t)(band + 1) * rows_ / bands_);
+		(*render_)(first, last);
+	}
+}
+
+void RenderPool::worker(bool pin)
+{
+	if (pin)
+		ThreadScheduling::instance().apply(ThreadRole::Render);
+
+	uint64_t seen = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			start_cv_.wait(lock, [this, seen] {
+				return stop_ || generation_ != seen;
+			});
+			if (stop_)
+				return;
+			seen = generation_;
+		}
+
+		render_bands();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			--busy_;
+		}
+		done_cv_.notify_one();
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads that render one frame in horizontal bands.
+//
+// Threads are created once and pinned to their own cores. run() hands them a
+// frame, renders bands on the calling thread as well and returns only when
+// every band is done, so a frame is complete when run() returns.
+class RenderPool {
+public:
+	// threads: helpers besides the calling thread; 0 renders inline
+	explicit RenderPool(int threads, bool pin = true);
+	~RenderPool();
+
+	RenderPool(const RenderPool &) = delete;
+	RenderPool &operator=(const RenderPool &) = delete;
+
+	// Split rows [0, rows) into bands and call render(first_row, last_row)
+	// once per band, in parallel. bands <= 0 uses one band per thread.
+	// Calls from several threads are serialized.
+	void run(int rows, int bands,
+		 const std::function<void(int, int)> &render);
+
+	// Threads that render a frame, including the caller of run()
+	int thread_count() const { return (int)threads_.size() + 1; }
+
+private:
+	void worker(bool pin);
+	void render_bands();
+
+	std::vector<std::thread> threads_;
+	std::mutex run_mutex_; // one frame at a time
+
+	// Current frame, published under mutex_ by bumping generation_
+	std::mutex mutex_;
+	std::condition_variable start_cv_;
+	std::condition_variable done_cv_;
+	uint64_t generation_;
+	bool stop_;
+	int busy_; // workers still inside the current frame
+	const std::function<void(int, int)> *render_;
+	int rows_;
+	int bands_;
+	std::atomic<int> next_band_;
+};
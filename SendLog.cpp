@@ -0,0 +1,120 @@
+#include "SendLog.h"
+#include <atomic>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+SendLog::SendLog()
+	: header_(nullptr),
+	  records_(nullptr),
+	  map_size_(0),
+#ifdef _WIN32
+	  file_(INVALID_HANDLE_VALUE),
+	  mapping_(NULL)
+#else
+	  fd_(-1)
+#endif
+{
+}
+
+SendLog::~SendLog()
+{
+	close();
+}
+
+bool SendLog::open(const std::string &path, uint64_t capacity,
+		   const SendLogInfo &info)
+{
+	close();
+	if (capacity == 0)
+		capacity = DEFAULT_CAPACITY;
+	map_size_ = HEADER_SIZE + (size_t)capacity * sizeof(SendLogRecord);
+
+	void *p_map = nullptr;
+#ifdef _WIN32
+	file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+			    FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+			    FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file_ == INVALID_HANDLE_VALUE)
+		return false;
+	mapping_ = CreateFileMappingA(file_, NULL, PAGE_READWRITE,
+				      (DWORD)((uint64_t)map_size_ >> 32),
+				      (DWORD)(map_size_ & 0xFFFFFFFF), NULL);
+	if (mapping_)
+		p_map = MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, map_size_);
+#else
+	fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd_ < 0)
+		return false;
+	if (ftruncate(fd_, (off_t)map_size_) == 0) {
+		p_map = mmap(NULL, map_size_, PROT_READ | PROT_WRITE,
+			     MAP_SHARED, fd_, 0);
+		if (p_map == MAP_FAILED)
+			p_map = nullptr;
+	}
+#endif
+	if (!p_map) {
+		close();
+		return false;
+	}
+
+	// Touch every page now so no record write faults one in later
+	volatile uint8_t *p = (volatile uint8_t *)p_map;
+	for (size_t offset = 0; offset < map_size_; offset += 4096)
+		p[offset] = 0;
+
+	header_ = (SendLogHeader *)p_map;
+	records_ = (SendLogRecord *)((uint8_t *)p_map + HEADER_SIZE);
+	memcpy(header_->magic, "SYNCLOG1", 8);
+	header_->header_size = (uint32_t)HEADER_SIZE;
+	header_->record_size = (uint32_t)sizeof(SendLogRecord);
+	header_->capacity = capacity;
+	header_->written = 0;
+	header_->frame_rate_N = info.frame_rate_N;
+	header_->frame_rate_D = info.frame_rate_D;
+	header_->fourcc = info.fourcc;
+	header_->xres = info.xres;
+	header_->yres = info.yres;
+	header_->sample_rate = info.sample_rate;
+	strncpy(header_->name, info.name.c_str(), sizeof(header_->name) - 1);
+	return true;
+}
+
+void SendLog::close()
+{
+#ifdef _WIN32
+	if (header_)
+		UnmapViewOfFile(header_);
+	if (mapping_)
+		CloseHandle(mapping_);
+	if (file_ != INVALID_HANDLE_VALUE)
+		CloseHandle(file_);
+	mapping_ = NULL;
+	file_ = INVALID_HANDLE_VALUE;
+#else
+	if (header_)
+		munmap(header_, map_size_);
+	if (fd_ >= 0)
+		::close(fd_);
+	fd_ = -1;
+#endif
+	header_ = nullptr;
+	records_ = nullptr;
+}
+
+void SendLog::commit(SendLogRecord &record)
+{
+	// The sequence number goes in after the fields it vouches for, and the
+	// ring end moves after the record is complete
+	const uint64_t n = header_->written;
+	std::atomic_thread_fence(std::memory_order_release);
+	record.sequence = n + 1;
+	std::atomic_thread_fence(std::memory_order_release);
+	header_->written = n + 1;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Memory-mapped ring file with one fixed-size record per sent video frame
+// and audio block.
+//
+// The file is a 4 KB SendLogHeader followed by capacity SendLogRecords.
+// Record n goes to slot n % capacity, so after a long run the file holds the
+// last capacity sends; header.written tells where the ring ends. The file is
+// sized and every page touched when it is opened, so writing a record is a
+// handful of stores: no system call, no allocation, no page fault. The OS
+// writes the pages back, also if the process dies.
+
+enum class SendLogKind : uint16_t { Video = 1, Audio = 2 };
+
+// Bits of SendLogRecord::pattern
+enum SendLogPattern : uint16_t {
+	SEND_LOG_WHITE = 1,      // white frame (BW mode)
+	SEND_LOG_TONE = 2,       // tone in the audio
+	SEND_LOG_MOVE = 4,       // Move mode rectangle
+	SEND_LOG_FRAME_CODE = 8, // frame code in video and audio
+	SEND_LOG_ASYNC = 16,     // video sent with send_video_async
+	SEND_LOG_BURN_IN = 32,   // timecode burned into the video
+};
+
+#pragma pack(push, 1)
+struct SendLogRecord {
+	uint64_t sequence;    // record number + 1; 0 = never written
+	uint64_t frame_index; // frame number of the stream's timebase
+	int64_t timestamp;    // NDI timestamp, 100 ns
+	int64_t timecode;     // NDI timecode, 100 ns
+	uint64_t send_start_ns; // os_gettime_ns before the send call
+	uint64_t send_end_ns;   // os_gettime_ns after the send call
+	uint32_t frame_id;      // ID of the frame code
+	uint16_t kind;          // SendLogKind
+	uint16_t pattern;       // SendLogPattern bits
+	int32_t samples;        // audio samples per channel, 0 for video
+	uint32_t reserved;
+};
+
+struct SendLogHeader {
+	char magic[8]; // "SYNCLOG1"
+	uint32_t header_size;
+	uint32_t record_size;
+	uint64_t capacity;
+	uint64_t written; // records written so far
+	int32_t frame_rate_N;
+	int32_t frame_rate_D;
+	uint32_t fourcc;
+	int32_t xres;
+	int32_t yres;
+	int32_t sample_rate;
+	char name[64]; // stream config name
+};
+#pragma pack(pop)
+
+static_assert(sizeof(SendLogRecord) == 64, "one record per cache line");
+
+// Stream settings stored in the header
+struct SendLogInfo {
+	std::string name;
+	int frame_rate_N;
+	int frame_rate_D;
+	uint32_t fourcc;
+	int xres;
+	int yres;
+	int sample_rate;
+};
+
+class SendLog {
+public:
+	static constexpr size_t HEADER_SIZE = 4096;
+	static constexpr uint64_t DEFAULT_CAPACITY = 1 << 21;
+
+	SendLog();
+	~SendLog();
+
+	SendLog(const SendLog &) = delete;
+	SendLog &operator=(const SendLog &) = delete;
+
+	// Create (or overwrite) path with room for capacity records. Returns
+	// false if the file cannot be created or mapped.
+	bool open(const std::string &path, uint64_t capacity,
+		  const SendLogInfo &info);
+	void close();
+	bool is_open() const { return header_ != nullptr; }
+
+	// The next record to fill in; commit() publishes it
+	SendLogRecord &next()
+	{
+		SendLogRecord &record =
+			records_[header_->written % header_->capacity];
+		record.sequence = 0;
+		return record;
+	}
+	void commit(SendLogRecord &record);
+
+private:
+	SendLogHeader *header_;
+	SendLogRecord *records_;
+	size_t map_size_;
+#ifdef _WIN32
+	void *file_;
+	void *mapping_;
+#else
+	int fd_;
+#endif
+};
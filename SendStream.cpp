@@ -0,0 +1,1028 @@
+#include "SendStream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <json.hpp>
+#include "FillKernels.h"
+#include "FrameArena.h"
+#include "FrameCode.h"
+#include "PatternRenderer.h"
+#include "PlatformTime.h"
+#include "ThreadScheduling.h"
+
+using json = nlohmann::json;
+
+#define PROFILE true
+
+static const int audio_rate = 48000;
+static const int tone_frequency = 400;
+
+int64_t obs_sync_white_time(int64_t time, uint8_t *p_data)
+{
+	uint8_t pixel0 = p_data[0];
+	uint8_t pixel1 = p_data[1];
+	// UYVY/UYVA, RGB, or the 16-bit Y sample 940 << 6 of P216/PA16
+	bool white = (((pixel0 == 128) && (pixel1 == 235)) ||
+		      ((pixel0 == 255) && (pixel1 == 255)) ||
+		      ((pixel0 == 0) && (pixel1 == 235)));
+	return white ? time : 0;
+}
+int64_t obs_sync_audio_time(int64_t time, float *p_data, int nsamples,
+			    int samplerate)
+{
+	int64_t return_time = 0;
+	int sample = 0;
+	while (sample < nsamples) {
+		float sample_amp = p_data[sample];
+		if (sample_amp != 0.0f) {
+			int64_t ns_per_sample = 1000000000 / samplerate;
+			return_time = time + sample * ns_per_sample;
+			return return_time;
+		}
+		sample++;
+	}
+	return return_time;
+}
+
+StreamConfig load_stream_config(const std::string &config_file)
+{
+	StreamConfig config;
+	config.file = config_file;
+
+	std::ifstream file(config_file);
+	if (!file.is_open()) {
+		throw std::runtime_error("Could not open config file: " +
+					 config_file);
+	}
+
+	json cfg;
+	file >> cfg;
+
+	// Read xres and yres from the JSON file
+	if (cfg.contains("xres") && cfg.contains("yres")) {
+		config.xres = cfg["xres"].get<int>();
+		config.yres = cfg["yres"].get<int>();
+	}
+	if (cfg.contains("frame_rate_N") && cfg.contains("frame_rate_D")) {
+		config.frame_rate_N = cfg["frame_rate_N"].get<int>();
+		config.frame_rate_D = cfg["frame_rate_D"].get<int>();
+	}
+	if (cfg.contains("format")) {
+		config.format = cfg["format"].get<int>();
+	}
+	if (cfg.contains("render_bands")) {
+		config.render_bands = cfg["render_bands"].get<int>();
+	}
+
+	// Name is the file name without folder (Windows or Unix separators)
+	// and without the .cfg extension
+	size_t sep_pos = config_file.find_last_of("\\/");
+	size_t name_start = (sep_pos == std::string::npos) ? 0 : sep_pos + 1;
+	size_t ext_pos = config_file.rfind(".cfg");
+	if (ext_pos != std::string::npos && ext_pos >= name_start) {
+		config.name =
+			config_file.substr(name_start, ext_pos - name_start);
+	} else {
+		config.name = config_file.substr(name_start);
+	}
+	return config;
+}
+
+SendStream::SendStream(const StreamConfig &config, const SendOptions &options)
+	: config_(config),
+	  options_(options),
+	  layout_(get_frame_layout(get_format_enum(config.format), config.xres,
+				   config.yres)),
+	  render_pool_(nullptr),
+	  ntp_clock_(nullptr),
+	  white_color_(128 | (235 << 8)),
+	  black_color_(128 | (16 << 8)),
+	  move_color_(0xFFFFFFFF),
+	  render_solid_(nullptr),
+	  render_box_(nullptr),
+	  white_frame_(nullptr),
+	  black_frame_(nullptr),
+	  card_frame_(nullptr),
+	  clip_(options.clip.get()),
+	  move_(false),
+	  frame_code_(false),
+	  frame_code_audio_(false),
+	  burn_in_(false),
+	  render_every_frame_(false),
+	  use_async_(options.async_buffers > 0),
+	  NDI_video_frame_(),
+	  NDI_audio_frame_(),
+	  audio_no_samples_(0),
+	  timebase_(config.frame_rate_N, config.frame_rate_D, audio_rate),
+	  base_frame_(0),
+	  frame_index_(0),
+	  tone_(tone_frequency, audio_rate),
+	  last_sound_(false),
+	  idx_(0),
+	  pacer_("Frame Pacing Late Wake [" + config.name + "]",
+		 config.frame_rate_N, config.frame_rate_D, options.spin_ns),
+	  perf_("Frame Rendering Time [" + config.name + "]"),
+	  perfv_("NDI Send Video Time [" + config.name + "]"),
+	  perfa_("NDI Send Audio Time [" + config.name + "]"),
+	  perfl_("NDI Send Loop Time [" + config.name + "]"),
+	  audio_block_(std::max(options.audio_block, 0)),
+	  audio_stop_(false),
+	  audio_pacer_("Audio Pacing Late Wake [" + config.name + "]",
+		       audio_rate, std::max(options.audio_block, 1),
+		       options.spin_ns),
+	  audio_sample_(0),
+	  audio_blocks_(0),
+	  code_frame_(~0ULL),
+	  telemetry_(nullptr),
+	  telemetry_counters_(),
+	  connections_interval_(1),
+	  audio_on_(false),
+	  audio_on_time_(0),
+	  audio_pending_(false),
+	  white_on_(false),
+	  white_on_time_(0),
+	  white_pending_(false)
+{
+}
+
+SendStream::~SendStream()
+{
+	// Close the sink first, it may still hold a video buffer
+	sink_.reset();
+	FrameArena::instance().release(NDI_audio_frame_.p_data);
+}
+
+bool SendStream::init(FrameCache &frame_cache, RenderPool &render_pool,
+		      int64_t start_time, const NtpClock *ntp_clock,
+		      Telemetry *telemetry)
+{
+	render_pool_ = &render_pool;
+	ntp_clock_ = ntp_clock;
+	const OutputType output_type = options_.output_type;
+	const int xres = config_.xres;
+	const int yres = config_.yres;
+
+	// Colors and renderers for this stream's format are fixed from here on
+	const PatternColors colors =
+		get_pattern_colors(layout_.fourcc, options_.move_color);
+	white_color_ = colors.white;
+	black_color_ = colors.black;
+	move_color_ = colors.move;
+	render_solid_ = select_pattern_renderer(layout_.fourcc,
+						PatternType::Solid);
+	render_box_ = select_pattern_renderer(layout_.fourcc, PatternType::Box);
+
+	std::cout << "Config name: " << config_.name.c_str() << std::endl;
+
+	// Frames get whole samples in a cadence that follows the exact frame
+	// rate (1601/1602 at 29.97), so the buffer holds the largest frame.
+	// The audio thread sends blocks of a fixed size instead.
+	audio_no_samples_ = audio_block_ > 0
+				    ? audio_block_
+				    : timebase_.max_samples_per_frame();
+
+	// We are going to create a video frame
+	NDI_video_frame_.frame_rate_N = config_.frame_rate_N;
+	NDI_video_frame_.frame_rate_D = config_.frame_rate_D;
+	NDI_video_frame_.xres = xres;
+	NDI_video_frame_.yres = yres;
+	NDI_video_frame_.FourCC = layout_.fourcc;
+	NDI_video_frame_.line_stride_in_bytes = (int)layout_.line_stride;
+
+	// A clip must already be in the stream's format
+	if (clip_) {
+		char name[5];
+		if (clip_->fourcc() != (uint32_t)layout_.fourcc ||
+		    clip_->xres() != xres || clip_->yres() != yres ||
+		    clip_->frame_size() < layout_.total_size) {
+			std::cerr << "Clip " << clip_->path() << " is not "
+				  << xres << "x" << yres << " "
+				  << fourcc_name(layout_.fourcc, name)
+				  << std::endl;
+			return false;
+		}
+		std::cout << "Clip: " << clip_->path() << " ("
+			  << clip_->frame_count() << " frames at "
+			  << clip_->frame_rate_N() << "/"
+			  << clip_->frame_rate_D() << ")" << std::endl;
+		if ((int64_t)clip_->frame_rate_N() * config_.frame_rate_D !=
+		    (int64_t)config_.frame_rate_N * clip_->frame_rate_D())
+			std::cout << "Clip rate differs from the stream's, "
+				     "playing one clip frame per frame"
+				  << std::endl;
+	}
+
+	// Render every distinct frame this output type can show once, up
+	// front. The send loop then only points p_data at the right one.
+	const TestCard *card = clip_ ? nullptr : options_.test_card.get();
+	if (card) {
+		card_frame_ = frame_cache.get_card(layout_, *card,
+						   options_.card_matrix, false,
+						   0, config_.render_bands);
+		if (!card_frame_) {
+			std::cerr << "Failed to allocate video buffer of size "
+				  << layout_.total_size << std::endl;
+			return false;
+		}
+		std::cout << "Test card: " << card->path() << " ("
+			  << card->width() << "x" << card->height() << ")"
+			  << std::endl;
+	}
+	if (output_type != OutputType::Black && !clip_) {
+		white_frame_ =
+			card ? frame_cache.get_card(layout_, *card,
+						    options_.card_matrix, true,
+						    white_color_,
+						    config_.render_bands)
+			     : frame_cache.get(layout_, white_color_,
+					       config_.render_bands);
+		if (!white_frame_) {
+			std::cerr << "Failed to allocate video buffer of size "
+				  << layout_.total_size << std::endl;
+			return false;
+		}
+	}
+	if (output_type != OutputType::White && !clip_) {
+		black_frame_ = card ? card_frame_
+				    : frame_cache.get(layout_, black_color_,
+						      config_.render_bands);
+		if (!black_frame_) {
+			std::cerr << "Failed to allocate video buffer of size "
+				  << layout_.total_size << std::endl;
+			return false;
+		}
+	}
+
+	// The frame code needs room for its cells
+	frame_code_ = options_.frame_code &&
+		      frame_code_geometry(xres, yres, options_.frame_code_corner,
+					  code_cell_, code_x_, code_y_);
+	if (options_.frame_code && !frame_code_)
+		std::cerr << "Frame too small for the frame code" << std::endl;
+	// Every audio burst needs silence after it within its frame, which is
+	// how the receiver finds where the next one starts. A cut-off burst
+	// would not decode, so at high frame rates only the video carries it.
+	frame_code_audio_ = frame_code_ && timebase_.min_samples_per_frame() >
+						   FRAME_CODE_AUDIO_SAMPLES;
+	if (frame_code_ && !frame_code_audio_)
+		std::cerr << "Frames too short for the audio frame code ("
+			  << timebase_.min_samples_per_frame() << " of "
+			  << FRAME_CODE_AUDIO_SAMPLES + 1
+			  << " samples), sending it in video only"
+			  << std::endl;
+
+	// The burn-in goes to the right, away from the flash, at the top
+	// unless the frame code is there
+	const int buffers = use_async_ ? options_.async_buffers : 1;
+	const bool code_top =
+		frame_code_ &&
+		(options_.frame_code_corner == FrameCodeCorner::TopLeft ||
+		 options_.frame_code_corner == FrameCodeCorner::TopRight);
+	burn_in_ = options_.burn_in &&
+		   timecode_.init(layout_, config_.frame_rate_N,
+				  config_.frame_rate_D, white_color_,
+				  black_color_, !code_top, buffers);
+	if (options_.burn_in && !burn_in_)
+		std::cerr << "Frame too small for the burn-in" << std::endl;
+
+	// Only Move mode and frame codes draw into private buffers, on a black
+	// background (or the test card) to start with, and clip frames that
+	// get the flash. With async send the SDK keeps reading the last
+	// submitted buffer, so they render round-robin into a ring.
+	move_ = output_type == OutputType::Move;
+	// Nothing waits on a null sink or without pacing, so such runs
+	// measure the generator: render every frame in full into the ring,
+	// so the FPS of each format reflects its renderer, not the send of a
+	// cached frame
+	render_every_frame_ = options_.sink == SinkType::Null ||
+			      options_.pacing != Pacing::Deadline;
+	if (move_ || frame_code_ || burn_in_ || render_every_frame_ ||
+	    (clip_ && output_type != OutputType::Black)) {
+		if (!frame_ring_.allocate(layout_, buffers)) {
+			std::cerr << "Failed to allocate video buffer of size "
+				  << layout_.total_size << std::endl;
+			return false;
+		}
+	}
+	// Rectangle last drawn into each Move buffer, restored on its next use
+	prev_lefts_.assign(frame_ring_.count(), -1);
+	prev_tops_.assign(frame_ring_.count(), -1);
+	slot_colors_.assign(frame_ring_.count(), ~black_color_);
+	for (int slot = 0; slot < frame_ring_.count() && !clip_; ++slot) {
+		if (card_frame_) {
+			memcpy(frame_ring_.data(slot), card_frame_,
+			       layout_.total_size);
+			slot_colors_[slot] = black_color_;
+		} else {
+			render_background(slot, black_color_);
+		}
+	}
+	if (use_async_)
+		std::cout << "Async video send, " << options_.async_buffers
+			  << " buffers" << std::endl;
+
+	// Create an audio buffer
+	NDI_audio_frame_.sample_rate = audio_rate;
+	// The audio frame code gets a third channel of its own
+	NDI_audio_frame_.no_channels = frame_code_audio_ ? 3 : 2;
+	NDI_audio_frame_.no_samples = timebase_.samples_in_frame(frame_index_);
+	NDI_audio_frame_.p_data =
+		(float *)FrameArena::instance().allocate(
+			sizeof(float) * audio_no_samples_ *
+			NDI_audio_frame_.no_channels);
+	NDI_audio_frame_.channel_stride_in_bytes =
+		sizeof(float) * audio_no_samples_;
+	if (!NDI_audio_frame_.p_data) {
+		std::cerr << "Failed to allocate audio buffer" << std::endl;
+		return false;
+	}
+
+	// Print the resolution for debugging
+	std::cout << "Video resolution: " << xres << "x" << yres << std::endl;
+	std::cout << "Frame rate: " << config_.frame_rate_N << "/"
+		  << config_.frame_rate_D << std::endl;
+	std::cout << "Frame time (ns): "
+		  << std::to_string(timebase_.frame_duration_ns()) << std::endl;
+	std::cout << "Format: " << config_.format << std::endl;
+	if (audio_block_ > 0)
+		std::cout << "Audio thread, blocks of " << audio_block_
+			  << " samples" << std::endl;
+	else
+		std::cout << "Audio no samples: "
+			  << timebase_.samples_in_frame(0) << " to "
+			  << audio_no_samples_ << std::endl;
+
+	switch (output_type) {
+	case OutputType::Black:
+		ndi_name_ = "Sync Test Black (" + config_.name + ")";
+		break;
+	case OutputType::White:
+		ndi_name_ = "Sync Test White (" + config_.name + ")";
+		break;
+	case OutputType::Move:
+		ndi_name_ = "Move (" + config_.name + ")";
+		break;
+	case OutputType::BW:
+	default:
+		ndi_name_ = "Sync Test (" + config_.name + ")";
+		break;
+	}
+	SinkParams sink_params;
+	sink_params.name = ndi_name_;
+	sink_params.file_name = config_.name;
+	sink_params.layout = layout_;
+	sink_params.frame_rate_N = config_.frame_rate_N;
+	sink_params.frame_rate_D = config_.frame_rate_D;
+	// With deadline pacing we emit frames on time ourselves; letting NDI
+	// clock video as well would block the loop a second time
+	sink_params.clock_video = options_.pacing == Pacing::Sink;
+	sink_params.v210 = is_v210_format(config_.format);
+
+	message_ = "NDI <- SyncTestSend [" + ndi_name_ + "]";
+
+	// We create the sender
+	sink_ = create_frame_sink(options_.sink, options_.sink_folder);
+	if (!sink_ || !sink_->open(sink_params)) {
+		std::cout << "Sender creation failed." << std::endl;
+		return false;
+	}
+
+	// Every send is recorded in <folder>/<config name>.sendlog
+	if (!options_.send_log_folder.empty()) {
+		const SendLogInfo info = {config_.name,
+					  config_.frame_rate_N,
+					  config_.frame_rate_D,
+					  (uint32_t)layout_.fourcc,
+					  xres,
+					  yres,
+					  audio_rate};
+		const std::string path = options_.send_log_folder + "/" +
+					 config_.name + ".sendlog";
+		if (send_log_.open(path, options_.send_log_records, info))
+			std::cout << "Send log: " << path << std::endl;
+		else
+			std::cerr << "Could not create send log " << path
+				  << std::endl;
+		// The audio thread logs into a file of its own, as every log
+		// has a single writer
+		if (audio_block_ > 0) {
+			const std::string audio_path =
+				options_.send_log_folder + "/" + config_.name +
+				".audio.sendlog";
+			if (audio_log_.open(audio_path,
+					    options_.send_log_records, info))
+				std::cout << "Send log: " << audio_path
+					  << std::endl;
+			else
+				std::cerr << "Could not create send log "
+					  << audio_path << std::endl;
+		}
+	}
+
+	std::cout << "Sending on " << ndi_name_ << " (" << sink_->type_name()
+		  << " sink)..." << std::endl;
+
+	const uint64_t ns_per_sec = 1000000000ULL;
+
+	// The first probe period starts at the first even second after
+	// start_time
+	const uint64_t start_second =
+		((start_time / ns_per_sec) + 1) * ns_per_sec;
+
+	if (output_type == OutputType::BW) {
+		const ProbeParams &probe = options_.probe;
+		probe_.build(probe, timebase_, start_second);
+		std::cout << "      White starts at: " << start_second << " ns"
+			  << std::endl;
+		std::cout << "Starting send loop at: " << start_time << " ns"
+			  << std::endl;
+		std::cout << "        Probe flashes: " << probe.on_ms
+			  << " ms every " << probe.period_ms << " ms";
+		if (probe.burst > 1)
+			std::cout << ", bursts of " << probe.burst << " "
+				  << probe.burst_gap_ms << " ms apart";
+		if (probe.jitter_ms > 0)
+			std::cout << ", jitter " << probe.jitter_ms
+				  << " ms (seed " << probe.seed << ")";
+		std::cout << std::endl;
+		std::cout << "   Probe cycle length: " << probe_.cycle_frames()
+			  << " frames, " << probe_.flashes() << " flashes"
+			  << std::endl;
+	}
+
+	// Frame times count from the frame that contains start_time
+	base_frame_ = timebase_.frame_at(start_time);
+	frame_index_ = base_frame_;
+	audio_sample_ = timebase_.first_sample(base_frame_);
+	if (frame_code_audio_ && audio_block_ > 0)
+		code_burst_.resize(timebase_.max_samples_per_frame());
+
+	if (telemetry) {
+		telemetry_ = telemetry->add(config_.name);
+		if (!telemetry_)
+			std::cerr << "No telemetry slot left for " << ndi_name_
+				  << std::endl;
+		// Ask the sink for its connections about once a second
+		connections_interval_ = std::max<uint64_t>(
+			1, (uint64_t)(config_.frame_rate_N /
+				      std::max(config_.frame_rate_D, 1)));
+		telemetry_counters_.connections = sink_->connections();
+	}
+	return true;
+}
+
+void SendStream::start_pacing(uint64_t now_ns)
+{
+	pacer_.start(now_ns);
+	if (audio_block_ > 0) {
+		// Block k is due when its first sample plays, on the same
+		// anchor as the frames
+		audio_pacer_.start(now_ns);
+		audio_thread_ = std::thread(&SendStream::audio_loop, this);
+	}
+}
+
+void SendStream::send_next()
+{
+	// Block until this frame is due, outside the timed loop section
+	// The pacer's frame number counts skipped frames too, so timestamps
+	// stay on the wall clock after a stall
+	uint64_t frame = (uint64_t)idx_;
+	if (options_.pacing == Pacing::Deadline)
+		frame = pacer_.wait_next();
+	frame_index_ = base_frame_ + frame;
+
+	send_frame();
+	++idx_;
+	if (telemetry_)
+		publish_telemetry();
+}
+
+void SendStream::publish_telemetry()
+{
+	static_assert(FramePacer::N_BUCKETS <= TELEMETRY_BUCKETS,
+		      "pacer buckets fit the telemetry slot");
+
+	TelemetryCounters &counters = telemetry_counters_;
+	counters.frames = (uint64_t)idx_;
+	counters.audio_blocks =
+		audio_block_ > 0 ? audio_blocks_.load(std::memory_order_relaxed)
+				 : (uint64_t)idx_;
+	if (options_.pacing == Pacing::Deadline) {
+		const int64_t late_ns = pacer_.last_late_ns();
+		if (late_ns >= Telemetry::LATE_NS)
+			++counters.late_frames;
+		++counters.late_wake[FramePacer::bucket_of(late_ns)];
+		counters.skipped_frames = pacer_.skipped();
+	}
+	if ((uint64_t)idx_ % connections_interval_ == 0)
+		counters.connections = sink_->connections();
+	Telemetry::publish(*telemetry_, counters);
+}
+
+void SendStream::finish()
+{
+	if (audio_thread_.joinable()) {
+		audio_stop_ = true;
+		audio_thread_.join();
+		audio_pacer_.report();
+	}
+
+	// Make the SDK release the last async frame before buffers are freed
+	if (use_async_) {
+		sink_->send_video_async(nullptr);
+		frame_ring_.flushed();
+	}
+
+	if (options_.pacing == Pacing::Deadline)
+		pacer_.report();
+}
+
+void SendStream::render_background(int slot, uint32_t color)
+{
+	// Buffers keep their background, so this only renders when the color
+	// changes (BW mode with frame codes: twice per flash), unless every
+	// frame is rendered
+	if (slot_colors_[slot] == color && !render_every_frame_)
+		return;
+
+	uint8_t *p_data = frame_ring_.data(slot);
+	const uint8_t *p_card = color == white_color_ ? white_frame_
+						      : card_frame_;
+	if (card_frame_ && !render_every_frame_) {
+		// Only the flash differs between the card frames: copy that
+		// region from the cached frame of the new state
+		const CardFlashRect rect =
+			card_flash_rect(config_.xres, config_.yres);
+		copy_rect(layout_, p_data, p_card, rect.x, rect.y, rect.w,
+			  rect.h);
+		slot_colors_[slot] = color;
+		return;
+	}
+
+	if (card_frame_) {
+		// The card is only converted once, at startup
+		copy_frame(p_data, p_card);
+	} else {
+		const PatternParams params = {color, 0, 0, config_.xres,
+					      config_.yres};
+		render_pool_->run(config_.yres, config_.render_bands,
+				  [&](int first, int last) {
+					  render_solid_(layout_, p_data,
+							params, first, last);
+				  });
+	}
+	if (burn_in_)
+		timecode_.invalidate(slot);
+	slot_colors_[slot] = color;
+	prev_lefts_[slot] = -1;
+	prev_tops_[slot] = -1;
+}
+
+void SendStream::copy_frame(uint8_t *p_data, const uint8_t *p_frame)
+{
+	const size_t total = layout_.total_size;
+	render_pool_->run(config_.yres, config_.render_bands,
+			  [&](int first, int last) {
+				  const size_t begin =
+					  total * first / config_.yres;
+				  const size_t end =
+					  total * last / config_.yres;
+				  memcpy(p_data + begin, p_frame + begin,
+					 end - begin);
+			  });
+}
+
+void SendStream::render_move(int slot, uint64_t frame)
+{
+	const int xres = config_.xres;
+	const int yres = config_.yres;
+	const int rect_w = 40;
+	const int rect_h = 40;
+
+	uint8_t *p_data = frame_ring_.data(slot);
+	int &prev_left = prev_lefts_[slot];
+	int &prev_top = prev_tops_[slot];
+
+	// Only the rectangle drawn into this buffer last time differs from the
+	// black background, so fill just that area back to black
+	if (prev_left >= 0 && prev_top >= 0) {
+		if (burn_in_ &&
+		    timecode_.intersects(prev_left, prev_top, rect_w, rect_h))
+			timecode_.invalidate(slot);
+		if (card_frame_) {
+			copy_rect(layout_, p_data, card_frame_, prev_left,
+				  prev_top, rect_w, rect_h);
+		} else {
+			const PatternParams restore = {black_color_, prev_left,
+						       prev_top, rect_w,
+						       rect_h};
+			render_box_(layout_, p_data, restore, 0, yres);
+		}
+	}
+
+	// compute a deterministic frame index from the (rounded) timestamp
+	const uint64_t frames_per_y = (uint64_t)xres / rect_w; // horizontal count
+	const uint64_t frames_per_x = (uint64_t)yres / rect_h; // vertical count
+	const uint64_t frames_per_image = frames_per_x * frames_per_y;
+
+	// wrap into single image sweep
+	uint64_t frame_idx_mod = frame % frames_per_image;
+
+	// derive grid coordinates
+	uint64_t y_index = frame_idx_mod / frames_per_y; // vertical cell index
+	uint64_t x_index = frame_idx_mod % frames_per_y; // horizontal cell index
+
+	int top = static_cast<int>(y_index * rect_h);
+	int left = static_cast<int>(x_index * rect_w);
+
+	const PatternParams box = {move_color_, left, top, rect_w, rect_h};
+	render_box_(layout_, p_data, box, 0, yres);
+	if (burn_in_ && timecode_.intersects(left, top, rect_w, rect_h))
+		timecode_.invalidate(slot);
+
+	// Store current rect as previous for next frame
+	prev_left = left;
+	prev_top = top;
+}
+
+uint8_t *SendStream::clip_frame(bool white, uint64_t frame_ns)
+{
+	// The clip loops on the stream's frame numbers, so it skips frames
+	// with the pacer and all streams show the same clip frame
+	const uint64_t count = clip_->frame_count();
+	const uint64_t n = (frame_index_ - base_frame_) % count;
+	// Sequential readahead does not know the loop wraps
+	if (n + 1 == count)
+		clip_->prefetch(0);
+
+	uint8_t *p_frame = const_cast<uint8_t *>(clip_->frame(n));
+	const bool flash = white && !move_;
+	if (!flash && !move_ && !frame_code_ && !burn_in_ &&
+	    !render_every_frame_)
+		return p_frame;
+
+	// NDI takes a frame as one buffer, so overlays need the whole frame
+	// copied; only flash frames (and Move or frame code runs) pay for it
+	const int slot = frame_ring_.acquire();
+	uint8_t *p_data = frame_ring_.data(slot);
+	copy_frame(p_data, p_frame);
+	if (burn_in_)
+		timecode_.invalidate(slot);
+	if (flash) {
+		const CardFlashRect rect =
+			card_flash_rect(config_.xres, config_.yres);
+		const PatternParams params = {white_color_, rect.x, rect.y,
+					      rect.w, rect.h};
+		render_box_(layout_, p_data, params, 0, config_.yres);
+	}
+	if (move_) {
+		// Nothing to restore in a fresh copy
+		prev_lefts_[slot] = -1;
+		prev_tops_[slot] = -1;
+		render_move(slot, frame_index_);
+	}
+	const uint32_t id = (uint32_t)(frame_index_ - base_frame_);
+	if (frame_code_)
+		draw_frame_code(p_data, id);
+	if (burn_in_)
+		timecode_.draw(slot, p_data, frame_ns, id);
+	return p_data;
+}
+
+void SendStream::draw_frame_code(uint8_t *p_data, uint32_t id)
+{
+	// Every cell is drawn, so the code does not depend on the background
+	for (int i = 0; i < FRAME_CODE_CELLS; ++i) {
+		const PatternParams cell = {
+			frame_code_cell(id, i) ? white_color_ : black_color_,
+			code_x_ + i * code_cell_, code_y_, code_cell_,
+			code_cell_};
+		render_box_(layout_, p_data, cell, 0, config_.yres);
+	}
+}
+
+void SendStream::send_frame_audio(bool sound, uint64_t frame_ns,
+				  uint64_t nanoseconds, uint16_t pattern)
+{
+	NDI_audio_frame_.no_samples = timebase_.samples_in_frame(frame_index_);
+
+	if (!last_sound_ && sound) {
+		tone_.reset();
+	}
+
+	if (PROFILE) perfa_.start();
+	// Fill audio: the left channel from the tone table, copied to the right
+	const int no_samples = NDI_audio_frame_.no_samples;
+	float *p_ch0 = NDI_audio_frame_.p_data;
+	if (sound) {
+		tone_.fill(p_ch0, no_samples);
+	} else {
+		memset(p_ch0, 0, no_samples * sizeof(float));
+		tone_.advance(no_samples);
+	}
+	float *p_ch1 = (float *)((uint8_t *)NDI_audio_frame_.p_data +
+				 NDI_audio_frame_.channel_stride_in_bytes);
+	memcpy(p_ch1, p_ch0, no_samples * sizeof(float));
+	last_sound_ = sound;
+
+	// The frame ID burst starts with the frame's first sample
+	if (frame_code_audio_)
+		frame_code_audio_write(
+			(float *)((uint8_t *)NDI_audio_frame_.p_data +
+				  2 * NDI_audio_frame_.channel_stride_in_bytes),
+			no_samples, (uint32_t)(frame_index_ - base_frame_));
+
+	NDI_audio_frame_.timestamp = frame_ns / 100;
+	NDI_audio_frame_.timecode = NDIlib_send_timecode_synthesize;
+	if (options_.setcode)
+		NDI_audio_frame_.timecode =
+			(nanoseconds + timebase_.frame_time_ns(idx_)) / 100;
+
+	// Log the audio time and audio frame
+	if (options_.output_type == OutputType::BW)
+		log_audio_time(NDI_audio_frame_.timestamp * 100,
+			       NDI_audio_frame_.p_data,
+			       NDI_audio_frame_.no_samples,
+			       NDI_audio_frame_.sample_rate);
+
+	const uint64_t send_start = send_log_.is_open() ? os_gettime_ns() : 0;
+	sink_->send_audio(NDI_audio_frame_);
+	if (send_log_.is_open())
+		log_send(send_log_, SendLogKind::Audio, frame_index_,
+			 NDI_audio_frame_.timestamp, NDI_audio_frame_.timecode,
+			 send_start, os_gettime_ns(),
+			 NDI_audio_frame_.no_samples, pattern);
+	if (PROFILE) perfa_.end();
+}
+
+void SendStream::audio_loop()
+{
+	ThreadScheduling::instance().apply(ThreadRole::Audio);
+	while (!audio_stop_) {
+		// The pacer skips blocks after a stall; so does the stream, to
+		// stay on the wall clock
+		const uint64_t block = audio_pacer_.wait_next();
+		audio_sample_ = timebase_.first_sample(base_frame_) +
+				block * (uint64_t)audio_block_;
+		send_audio_block();
+		audio_blocks_.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void SendStream::send_audio_block()
+{
+	if (PROFILE) perfa_.start();
+	const uint64_t nanoseconds = os_gettime_ns();
+	const int64_t correction =
+		ntp_clock_ ? ntp_clock_->correction_ns(nanoseconds) : 0;
+	const uint64_t first = audio_sample_;
+	const int no_samples = audio_block_;
+	float *p_ch0 = NDI_audio_frame_.p_data;
+	float *p_ch2 = (float *)((uint8_t *)NDI_audio_frame_.p_data +
+				 2 * NDI_audio_frame_.channel_stride_in_bytes);
+
+	// The block in runs of samples of the same frame, each with the tone
+	// of its frame, so an onset lands on the first sample of the frame
+	// that turns white
+	bool any_sound = false;
+	for (int done = 0; done < no_samples;) {
+		const uint64_t sample = first + done;
+		const uint64_t frame = timebase_.frame_of_sample(sample);
+		const uint64_t frame_first = timebase_.first_sample(frame);
+		const int run = (int)std::min<uint64_t>(
+			no_samples - done,
+			timebase_.first_sample(frame + 1) - sample);
+		const bool sound = white_at(timebase_.frame_time_ns(frame) +
+					    (uint64_t)correction);
+		if (!last_sound_ && sound)
+			tone_.reset();
+		if (sound) {
+			tone_.fill(p_ch0 + done, run);
+		} else {
+			memset(p_ch0 + done, 0, run * sizeof(float));
+			tone_.advance(run);
+		}
+		last_sound_ = sound;
+		any_sound = any_sound || sound;
+
+		// The frame ID burst starts with the frame's first sample
+		if (frame_code_audio_) {
+			if (frame != code_frame_) {
+				frame_code_audio_write(
+					code_burst_.data(),
+					timebase_.samples_in_frame(frame),
+					(uint32_t)(frame - base_frame_));
+				code_frame_ = frame;
+			}
+			memcpy(p_ch2 + done,
+			       code_burst_.data() + (sample - frame_first),
+			       run * sizeof(float));
+		}
+		done += run;
+	}
+	float *p_ch1 = (float *)((uint8_t *)NDI_audio_frame_.p_data +
+				 NDI_audio_frame_.channel_stride_in_bytes);
+	memcpy(p_ch1, p_ch0, no_samples * sizeof(float));
+
+	NDI_audio_frame_.no_samples = no_samples;
+	NDI_audio_frame_.timestamp =
+		(timebase_.sample_time_ns(first) + correction) / 100;
+	NDI_audio_frame_.timecode = NDIlib_send_timecode_synthesize;
+	if (options_.setcode)
+		NDI_audio_frame_.timecode =
+			(nanoseconds +
+			 timebase_.sample_time_ns(
+				 first - timebase_.first_sample(base_frame_))) /
+			100;
+
+	if (options_.output_type == OutputType::BW)
+		log_audio_time(NDI_audio_frame_.timestamp * 100,
+			       NDI_audio_frame_.p_data, no_samples,
+			       NDI_audio_frame_.sample_rate);
+
+	const uint64_t send_start = audio_log_.is_open() ? os_gettime_ns() : 0;
+	sink_->send_audio(NDI_audio_frame_);
+	if (audio_log_.is_open())
+		log_send(audio_log_, SendLogKind::Audio,
+			 timebase_.frame_of_sample(first),
+			 NDI_audio_frame_.timestamp, NDI_audio_frame_.timecode,
+			 send_start, os_gettime_ns(), no_samples,
+			 (any_sound ? SEND_LOG_TONE : 0) |
+				 (frame_code_audio_ ? SEND_LOG_FRAME_CODE : 0));
+	if (PROFILE) perfa_.end();
+}
+
+bool SendStream::white_at(uint64_t frame_ns) const
+{
+	switch (options_.output_type) {
+	case OutputType::BW:
+		return probe_.on(timebase_.frame_at(frame_ns));
+	case OutputType::Black:
+		return false;
+	default:
+		return true;
+	}
+}
+
+void SendStream::send_frame()
+{
+	const OutputType output_type = options_.output_type;
+
+	if (PROFILE) perfl_.start();
+
+	uint64_t nanoseconds = os_gettime_ns();
+
+	uint64_t frame_ns = timebase_.frame_time_ns(frame_index_);
+	if (ntp_clock_)
+		frame_ns += (uint64_t)ntp_clock_->correction_ns(nanoseconds);
+
+	// Determine if the frame should be black or white based on the output
+	// type, and make audio follow the white interval as well
+	const bool white = white_at(frame_ns);
+	const bool sound = white;
+
+	// What this frame shows and plays, for the send log
+	uint16_t pattern = 0;
+	if (send_log_.is_open()) {
+		pattern = (white ? SEND_LOG_WHITE : 0) |
+			  (sound ? SEND_LOG_TONE : 0) |
+			  (move_ ? SEND_LOG_MOVE : 0) |
+			  (frame_code_ ? SEND_LOG_FRAME_CODE : 0) |
+			  (use_async_ ? SEND_LOG_ASYNC : 0) |
+			  (burn_in_ ? SEND_LOG_BURN_IN : 0);
+	}
+
+	// Audio goes out with the frame unless it has a thread of its own
+	if (audio_block_ == 0)
+		send_frame_audio(sound, frame_ns, nanoseconds, pattern);
+
+	// Start timing for this frame's video fill section
+	if (PROFILE) perf_.start();
+
+	// Point the frame at its pre-rendered image or clip frame; only Move
+	// mode, frame codes, the burn-in and benchmark runs draw into their
+	// own buffer
+	if (clip_) {
+		NDI_video_frame_.p_data = clip_frame(white, frame_ns);
+	} else if (move_ || frame_code_ || burn_in_ || render_every_frame_) {
+		const int slot = frame_ring_.acquire();
+		uint8_t *p_data = frame_ring_.data(slot);
+		if (move_) {
+			if (render_every_frame_)
+				render_background(slot, black_color_);
+			render_move(slot, frame_index_);
+		} else {
+			render_background(slot,
+					  white ? white_color_ : black_color_);
+		}
+		const uint32_t id = (uint32_t)(frame_index_ - base_frame_);
+		if (frame_code_)
+			draw_frame_code(p_data, id);
+		if (burn_in_)
+			timecode_.draw(slot, p_data, frame_ns, id);
+		NDI_video_frame_.p_data = p_data;
+	} else {
+		NDI_video_frame_.p_data = white ? white_frame_ : black_frame_;
+	}
+	// Stop timing and measure elapsed time for the video fill section
+	if (PROFILE) perf_.end();
+
+	if (PROFILE) perfv_.start();
+	NDI_video_frame_.timestamp = frame_ns / 100;
+	NDI_video_frame_.timecode = NDIlib_send_timecode_synthesize;
+	if (options_.setcode)
+		NDI_video_frame_.timecode =
+			(nanoseconds + timebase_.frame_time_ns(idx_)) / 100;
+
+	// Check if start of white frame and log the frame time, audio time and diff
+	if (output_type == OutputType::BW)
+		log_video_time(NDI_video_frame_.timestamp * 100,
+			       NDI_video_frame_.p_data);
+
+	const uint64_t send_start = send_log_.is_open() ? os_gettime_ns() : 0;
+	if (use_async_) {
+		// Returns immediately; the next frame renders while this one
+		// is transmitted
+		sink_->send_video_async(&NDI_video_frame_);
+		frame_ring_.submitted(NDI_video_frame_.p_data);
+	} else {
+		sink_->send_video(NDI_video_frame_);
+	}
+	if (send_log_.is_open())
+		log_send(send_log_, SendLogKind::Video, frame_index_,
+			 NDI_video_frame_.timestamp, NDI_video_frame_.timecode,
+			 send_start, os_gettime_ns(), 0, pattern);
+	if (PROFILE) perfv_.end();
+
+	if (PROFILE) perfl_.end();
+}
+
+void SendStream::log_send(SendLog &log, SendLogKind kind,
+			  uint64_t frame_index, int64_t timestamp,
+			  int64_t timecode, uint64_t start_ns, uint64_t end_ns,
+			  int samples, uint16_t pattern)
+{
+	SendLogRecord &record = log.next();
+	record.frame_index = frame_index;
+	record.timestamp = timestamp;
+	record.timecode = timecode;
+	record.send_start_ns = start_ns;
+	record.send_end_ns = end_ns;
+	record.frame_id = (uint32_t)(frame_index - base_frame_);
+	record.kind = (uint16_t)kind;
+	record.pattern = pattern;
+	record.samples = samples;
+	log.commit(record);
+}
+
+void SendStream::print_onsets()
+{
+	int64_t diff = white_on_time_ - audio_on_time_;
+
+	printf("AT %lld WT %lld: %17lld %s\n", (long long)audio_on_time_,
+	       (long long)white_on_time_, (long long)diff, message_.c_str());
+	audio_pending_ = false;
+	white_pending_ = false;
+}
+
+void SendStream::log_video_time(uint64_t time_ns, uint8_t *data)
+{
+	// If white frame is going from off to on, log the frame time, audio time and diff
+	int64_t white_time = obs_sync_white_time(time_ns, data);
+	if (!white_on_ && (white_time > 0)) {
+		white_on_ = true;
+		std::lock_guard<std::mutex> lock(onset_mutex_);
+		white_on_time_ = white_time;
+		if (audio_pending_)
+			print_onsets();
+		else
+			white_pending_ = true;
+	} else if (white_on_ && (white_time == 0)) {
+		white_on_ = false;
+	}
+}
+
+void SendStream::log_audio_time(uint64_t time_ns, float *data,
+				int no_samples, int sample_rate)
+{
+	// If audio on, log the frame time
+	int64_t audio_time =
+		obs_sync_audio_time(time_ns, data, no_samples, sample_rate);
+	if (!audio_on_ && (audio_time > 0)) {
+		audio_on_ = true; // set audio on
+		std::lock_guard<std::mutex> lock(onset_mutex_);
+		audio_on_time_ = audio_time;
+		if (white_pending_)
+			print_onsets();
+		else
+			audio_pending_ = true;
+	} else if (audio_on_ && (audio_time == 0)) {
+		audio_on_ = false;
+	}
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstddef>
+#include <Processing.NDI.Lib.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ClipFile.h"
+#include "FrameCache.h"
+#include "FrameCode.h"
+#include "FrameLayout.h"
+#include "FramePacer.h"
+#include "FrameSink.h"
+#include "NtpClock.h"
+#include "PatternRenderer.h"
+#include "FrameRing.h"
+#include "PerfTimer.h"
+#include "ProbeSchedule.h"
+#include "RenderPool.h"
+#include "SendLog.h"
+#include "Telemetry.h"
+#include "TestCard.h"
+#include "Timebase.h"
+#include "TimecodeBurnIn.h"
+#include "ToneGenerator.h"
+
+enum class OutputType { Black, White, BW, Move };
+enum class AudioType { Zero, Peak, Spike };
+
+// What sets the frame rate
+enum class Pacing {
+	Deadline, // our own deadline pacer
+	Sink,     // the sink blocks in every send (NDI clock_video)
+	Off       // nothing, frames go out as fast as they render
+};
+
+// Command line options shared by every stream in the process
+struct SendOptions {
+	OutputType output_type = OutputType::BW;
+	bool setcode = false;
+	NamedColor move_color = NamedColor::White;
+	int async_buffers = 0;       // 0 = synchronous send
+	Pacing pacing = Pacing::Deadline;
+	uint64_t spin_ns = FramePacer::DEFAULT_SPIN_NS;
+	bool frame_code = false; // frame ID in every frame's video and audio
+	FrameCodeCorner frame_code_corner = FrameCodeCorner::BottomLeft;
+	bool burn_in = false; // timecode and frame ID burned into the picture
+#ifdef SYNCTEST_NO_NDI
+	SinkType sink = SinkType::Null; // built without the NDI SDK
+#else
+	SinkType sink = SinkType::Ndi;
+#endif
+	std::string sink_folder = "."; // where the file sink writes
+	std::string send_log_folder;   // empty = no send log
+	uint64_t send_log_records = SendLog::DEFAULT_CAPACITY;
+	ProbeParams probe; // when BW mode flashes
+	// Samples per audio block sent from a thread of its own on its own
+	// deadlines; 0 = one block per video frame from the send loop
+	int audio_block = 0;
+	// Shown instead of black, with the flash drawn over its corner
+	std::shared_ptr<const TestCard> test_card;
+	ColorMatrix card_matrix = ColorMatrix::Auto;
+	// Played in a loop instead of solid frames or the card
+	std::shared_ptr<const ClipFile> clip;
+};
+
+// Settings of one stream, read from its .cfg file
+struct StreamConfig {
+	std::string file;
+	std::string name = "DefaultName"; // file name without folder and .cfg
+	int xres = 1920;
+	int yres = 1080;
+	int frame_rate_N = 30000;
+	int frame_rate_D = 1000;
+	int format = NDIlib_FourCC_type_UYVY;
+	int render_bands = 0; // bands per full-frame render, 0 = one per thread
+};
+
+// Read a .cfg file. Throws std::runtime_error if it cannot be read.
+StreamConfig load_stream_config(const std::string &config_file);
+
+// One sender with its own buffers, timers, pacing and sink. Solid frames come
+// from a FrameCache shared with the other streams, so streams with the same
+// format and resolution send the very same buffers.
+class SendStream {
+public:
+	SendStream(const StreamConfig &config, const SendOptions &options);
+	~SendStream();
+
+	SendStream(const SendStream &) = delete;
+	SendStream &operator=(const SendStream &) = delete;
+
+	// Render the cached frames, allocate buffers and open the sink.
+	// Full frames are rendered in bands on render_pool. start_time is the
+	// shared start of all streams in ns. With ntp_clock, timestamps follow
+	// its correction. With telemetry, the stream's counters are published
+	// in a slot of its segment after every frame.
+	bool init(FrameCache &frame_cache, RenderPool &render_pool,
+		  int64_t start_time, const NtpClock *ntp_clock = nullptr,
+		  Telemetry *telemetry = nullptr);
+
+	// Anchor frame pacing at now_ns (os_gettime_ns time) and start the
+	// audio thread, if the stream has one
+	void start_pacing(uint64_t now_ns);
+	// When the next frame is due (os_gettime_ns time)
+	uint64_t next_deadline() const { return pacer_.next_deadline(); }
+
+	// Wait until the next frame is due (when deadline pacing), then render
+	// and send it with its audio
+	void send_next();
+
+	// Stop the audio thread, flush async video and print final statistics
+	void finish();
+
+	const std::string &ndi_name() const { return ndi_name_; }
+	const StreamConfig &config() const { return config_; }
+	// Video frames sent so far
+	uint64_t frames_sent() const { return (uint64_t)idx_; }
+	// Times of the video fill and the video send call; safe to snapshot
+	// while the stream runs
+	const LatencyHistogram &render_histogram() const
+	{
+		return perf_.histogram();
+	}
+	const LatencyHistogram &send_histogram() const
+	{
+		return perfv_.histogram();
+	}
+
+private:
+	void send_frame();
+	void send_frame_audio(bool sound, uint64_t frame_ns,
+			      uint64_t nanoseconds, uint16_t pattern);
+	void send_audio_block();
+	void audio_loop();
+	// Whether the frame at frame_ns (timebase time) is white with tone
+	bool white_at(uint64_t frame_ns) const;
+	void publish_telemetry();
+	void render_background(int slot, uint32_t color);
+	void copy_frame(uint8_t *p_data, const uint8_t *p_frame);
+	void render_move(int slot, uint64_t frame);
+	uint8_t *clip_frame(bool white, uint64_t frame_ns);
+	void draw_frame_code(uint8_t *p_data, uint32_t id);
+	void log_send(SendLog &log, SendLogKind kind, uint64_t frame_index,
+		      int64_t timestamp, int64_t timecode, uint64_t start_ns,
+		      uint64_t end_ns, int samples, uint16_t pattern);
+	// Onset times are in ns, as in SyncTestReceive
+	void log_video_time(uint64_t time_ns, uint8_t *data);
+	void print_onsets(); // with onset_mutex_ held
+	void log_audio_time(uint64_t time_ns, float *data, int no_samples,
+			    int sample_rate);
+
+	const StreamConfig config_;
+	const SendOptions options_;
+	FrameLayout layout_;
+	RenderPool *render_pool_;
+	const NtpClock *ntp_clock_;
+	uint32_t white_color_;
+	uint32_t black_color_;
+	uint32_t move_color_;
+	PatternRenderFn render_solid_;
+	PatternRenderFn render_box_;
+
+	// Pre-rendered frames owned by the shared FrameCache. With a test
+	// card, black is the card and white the card with the flash.
+	uint8_t *white_frame_;
+	uint8_t *black_frame_;
+	uint8_t *card_frame_; // the card alone, or nullptr
+	const ClipFile *clip_;
+
+	// Move mode, frame codes and the burn-in, and flashes over a clip,
+	// draw into private buffers
+	bool move_;
+	bool frame_code_;
+	bool frame_code_audio_; // frames long enough for the audio burst
+	bool burn_in_;
+	// Benchmark runs render every frame in full instead (see init)
+	bool render_every_frame_;
+	TimecodeBurnIn timecode_;
+	bool use_async_;
+	FrameRing frame_ring_;
+	std::vector<uint32_t> slot_colors_; // background of each buffer
+	std::vector<int> prev_lefts_;
+	std::vector<int> prev_tops_;
+	int code_cell_;
+	int code_x_;
+	int code_y_;
+
+	NDIlib_video_frame_v2_t NDI_video_frame_;
+	NDIlib_audio_frame_v2_t NDI_audio_frame_;
+	int audio_no_samples_; // samples the audio buffer holds per channel
+	std::unique_ptr<FrameSink> sink_;
+	std::string ndi_name_;
+	std::string message_;
+
+	Timebase timebase_;
+	uint64_t base_frame_;  // frame number of start_time
+	uint64_t frame_index_; // frame number of the frame being sent
+	ProbeSchedule probe_;
+	ToneGenerator tone_;
+	bool last_sound_;
+	int idx_;
+
+	FramePacer pacer_;
+	SendLog send_log_;
+	PerfTimer perf_;
+	PerfTimer perfv_;
+	PerfTimer perfa_;
+	PerfTimer perfl_;
+
+	// Audio thread (audio_block > 0). It only reads state that is fixed
+	// after init, the probe schedule above all, and works out the tone
+	// of each sample from the frame it belongs to, so it needs nothing
+	// from the send loop and onsets fall on the frame's first sample.
+	int audio_block_;
+	std::thread audio_thread_;
+	std::atomic<bool> audio_stop_;
+	FramePacer audio_pacer_;
+	uint64_t audio_sample_; // first sample of the next block
+	std::atomic<uint64_t> audio_blocks_;
+	SendLog audio_log_;
+	std::vector<float> code_burst_; // frame code audio of code_frame_
+	uint64_t code_frame_;
+
+	TelemetrySlot *telemetry_;
+	TelemetryCounters telemetry_counters_;
+	uint64_t connections_interval_; // frames between connection polls
+
+	// State of the white/tone transition log. With an audio thread either
+	// onset can come first; the second one prints the pair.
+	std::mutex onset_mutex_;
+	bool audio_on_;
+	int64_t audio_on_time_;
+	bool audio_pending_;
+	bool white_on_;
+	int64_t white_on_time_;
+	bool white_pending_;
+};
@@ -0,0 +1,70 @@
+#include "StreamScheduler.h"
+#include <algorithm>
+#include "ThreadScheduling.h"
+
+StreamScheduler::StreamScheduler(const std::vector<SendStream *> &streams,
+				 int workers, Pacing pacing)
+	: pacing_(pacing)
+{
+	if (pacing == Pacing::Sink) {
+		workers = (int)streams.size();
+	} else if (workers <= 0) {
+		workers = (int)std::thread::hardware_concurrency();
+		if (workers <= 0)
+			workers = 1;
+	}
+	workers = std::max(1, std::min(workers, (int)streams.size()));
+
+	assignments_.resize(workers);
+	for (size_t i = 0; i < streams.size(); ++i)
+		assignments_[i % workers].push_back(streams[i]);
+}
+
+StreamScheduler::~StreamScheduler()
+{
+	join();
+}
+
+void StreamScheduler::start(const std::atomic<bool> &exit_loop)
+{
+	for (auto &streams : assignments_)
+		threads_.emplace_back(run_worker, std::cref(streams),
+				      std::cref(exit_loop), pacing_);
+}
+
+void StreamScheduler::join()
+{
+	for (auto &thread : threads_) {
+		if (thread.joinable())
+			thread.join();
+	}
+	threads_.clear();
+}
+
+void StreamScheduler::run_worker(const std::vector<SendStream *> &streams,
+				 const std::atomic<bool> &exit_loop,
+				 Pacing pacing)
+{
+	ThreadScheduling::instance().apply(ThreadRole::Send);
+
+	// Without deadlines nothing says which stream is due, so every stream
+	// sends one frame in turn
+	if (pacing != Pacing::Deadline) {
+		while (!exit_loop) {
+			for (SendStream *stream : streams)
+				stream->send_next();
+		}
+		return;
+	}
+
+	while (!exit_loop) {
+		// Serve the stream whose frame is due first; its send_next()
+		// waits for that deadline
+		SendStream *next = streams[0];
+		for (SendStream *stream : streams) {
+			if (stream->next_deadline() < next->next_deadline())
+				next = stream;
+		}
+		next->send_next();
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "SendStream.h"
+
+// Runs a set of streams on a fixed pool of worker threads. Streams are dealt
+// round-robin to the workers; each worker always serves the stream whose
+// next frame is due first, so one thread can keep many streams on time.
+// Without deadline pacing a worker sends one frame of each stream in turn.
+class StreamScheduler {
+public:
+	// workers <= 0 picks one per hardware thread, capped at the stream
+	// count. When the sink paces video it blocks in every send, so each
+	// stream gets its own worker.
+	StreamScheduler(const std::vector<SendStream *> &streams, int workers,
+			Pacing pacing);
+	~StreamScheduler();
+
+	StreamScheduler(const StreamScheduler &) = delete;
+	StreamScheduler &operator=(const StreamScheduler &) = delete;
+
+	// Start the workers; they run until exit_loop is set
+	void start(const std::atomic<bool> &exit_loop);
+	// Wait for all workers to finish
+	void join();
+
+	int worker_count() const { return (int)assignments_.size(); }
+
+private:
+	static void run_worker(const std::vector<SendStream *> &streams,
+			       const std::atomic<bool> &exit_loop,
+			       Pacing pacing);
+
+	const Pacing pacing_;
+
+	std::vector<std::vector<SendStream *>> assignments_;
+	std::vector<std::thread> threads_;
+};
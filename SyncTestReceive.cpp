@@ -2,6 +2,8 @@
 #include <cstdio>
 #include <chrono>
 #include <thread>
+#include "FrameCode.h"
+#include "Telemetry.h"
 
 
 #ifdef _WIN32
@@ -46,6 +48,16 @@ int64_t obs_sync_audio_time(int64_t time, float* p_data, int nsamples, int sampl
 static uint64_t last_audio_sync_time = 0;
 static uint64_t last_video_sync_time = 0;
 
+// Live counters for monitors, published with -telemetry
+static TelemetrySlot* telemetry_slot = nullptr;
+static TelemetryCounters telemetry_counters = {};
+
+static void publish_telemetry()
+{
+	if (telemetry_slot)
+		Telemetry::publish(*telemetry_slot, telemetry_counters);
+}
+
 void obs_sync_debug_log_video_time(const char* message, uint64_t timestamp, uint8_t* data)
 {
 
@@ -56,6 +68,7 @@ void obs_sync_debug_log_video_time(const char* message, uint64_t timestamp, uint
 		white_on_time = white_time;
 
 		int64_t diff = white_on_time - audio_on_time;
+		telemetry_counters.av_offset_ns = diff;
 		if ((abs(diff) / 1000000) < 80) {
 			printf("Video AT: %10lld WT: %10lld Delta: %5lld, Last: %lld %s\n",
 			       audio_on_time / 1000000, white_on_time / 1000000,
@@ -80,6 +93,7 @@ void obs_sync_debug_log_audio_time(const char* message, uint64_t timestamp, floa
 		audio_on_time = audio_time;
 
 		int64_t diff = white_on_time - audio_on_time;
+		telemetry_counters.av_offset_ns = diff;
 		if ((abs(diff)/1000000) < 80)
 			printf("Audio AT: %10lld WT: %10lld Delta: %5lld, Last: %lld %s\n",
 				audio_on_time / 1000000, white_on_time / 1000000,
@@ -93,11 +107,68 @@ void obs_sync_debug_log_audio_time(const char* message, uint64_t timestamp, floa
 }
 enum class SyncType { Code, Stamp };
 
+// Times at which each frame ID was seen in video and in audio, indexed by
+// id % FRAME_CODE_HISTORY. A frame is reported once both have been seen.
+static const int FRAME_CODE_HISTORY = 256;
+struct FrameCodeSeen {
+	bool valid = false;
+	uint32_t id = 0;
+	int64_t time = 0;
+};
+static FrameCodeSeen video_seen[FRAME_CODE_HISTORY];
+static FrameCodeSeen audio_seen[FRAME_CODE_HISTORY];
+static bool have_video_id = false;
+static uint32_t last_video_id = 0;
+static uint64_t video_drops = 0;
+static bool have_audio_id = false;
+static uint32_t last_audio_id = 0;
+static uint64_t audio_drops = 0;
+
+// Count IDs skipped since the last one seen; repeats return false
+static bool frame_code_next(uint32_t id, bool& have_id, uint32_t& last_id, uint64_t& drops)
+{
+	if (have_id) {
+		if (id == last_id)
+			return false;
+		uint32_t gap = id - last_id;
+		if (gap > 1 && gap < 0x80000000u)
+			drops += gap - 1;
+	}
+	have_id = true;
+	last_id = id;
+	return true;
+}
+
+static void frame_code_seen(const char* message, uint32_t id, int64_t time, bool video)
+{
+	FrameCodeSeen& self = (video ? video_seen : audio_seen)[id % FRAME_CODE_HISTORY];
+	self.valid = true;
+	self.id = id;
+	self.time = time;
+
+	const FrameCodeSeen& other = (video ? audio_seen : video_seen)[id % FRAME_CODE_HISTORY];
+	if (!other.valid || other.id != id)
+		return;
+
+	const FrameCodeSeen& v = video ? self : other;
+	const FrameCodeSeen& a = video ? other : self;
+	telemetry_counters.av_offset_ns = v.time - a.time;
+	telemetry_counters.video_drops = video_drops;
+	telemetry_counters.audio_drops = audio_drops;
+	printf("Frame %10u AV offset: %8.3f ms, video drops: %llu, audio drops: %llu %s\n",
+	       id, (v.time - a.time) / 1000000.0,
+	       (unsigned long long)video_drops, (unsigned long long)audio_drops,
+	       message);
+}
+
 int main(int argc, char* argv[])
 {
 	// Default source name
 	const char* desired_source_name = "";
 	SyncType sync_type = SyncType::Code;
+	bool frame_code = false;
+	FrameCodeCorner frame_code_corner = FrameCodeCorner::BottomLeft;
+	bool telemetry_on = false;
 
 	// Parse command line arguments
 	for (int i = 1; i < argc; ++i) {
@@ -105,6 +176,14 @@ int main(int argc, char* argv[])
 			desired_source_name = argv[i] + 8;
 		} else if (strcmp(argv[i], "-stamp") == 0) {
 			sync_type = SyncType::Stamp;
+		} else if (strncmp(argv[i], "-framecode", 10) == 0) {
+			// Decode the per-frame ID that SyncTestSend -framecode embeds
+			frame_code = true;
+			if (argv[i][10] == '=' && !parse_frame_code_corner(argv[i] + 11, frame_code_corner))
+				printf("Unknown frame code corner: %s\n", argv[i] + 11);
+		} else if (strcmp(argv[i], "-telemetry") == 0) {
+			// Publish live counters in shared memory for monitors
+			telemetry_on = true;
 		}
 	}
 
@@ -152,6 +231,16 @@ int main(int argc, char* argv[])
 	char message[256];
 	sprintf_s<256>(message, "NDI -> SyncTestReceive [%s]", desired_source_name);
 
+	Telemetry telemetry;
+	if (telemetry_on) {
+		if (telemetry.create("receive", 1)) {
+			telemetry_slot = telemetry.add(desired_source_name);
+			printf("Telemetry: %s\n", telemetry.segment_name().c_str());
+		} else {
+			printf("Could not create telemetry segment\n");
+		}
+	}
+
 	NDIlib_recv_create_v3_t recv_desc;
 	recv_desc.color_format = NDIlib_recv_color_format_e_UYVY_BGRA;
 
@@ -171,10 +260,62 @@ int main(int argc, char* argv[])
 	NDIlib_find_destroy(pNDI_find);
 
 	uint64_t last_timestamp = 0LL;
+
+	FrameCodeAudioDecoder audio_decoder([&](uint32_t id, int64_t time) {
+		if (frame_code_next(id, have_audio_id, last_audio_id, audio_drops))
+			frame_code_seen(message, id, time, false);
+	});
 	// Run for one minute
 	using namespace std::chrono;
 	for (const auto start = high_resolution_clock::now(); high_resolution_clock::now() - start < minutes(5);) {
 	
+		if (frame_code) {
+			// Take exactly the queued audio so the code is not resampled,
+			// and keep the stream continuous for the burst decoder
+			int depth = NDIlib_framesync_audio_queue_depth(pNDI_framesync);
+			if (depth > 0) {
+				NDIlib_audio_frame_v2_t audio_frame;
+				NDIlib_framesync_capture_audio(pNDI_framesync, &audio_frame, 48000, 4, depth);
+				if (audio_frame.p_data)
+					telemetry_counters.audio_blocks++;
+				if (audio_frame.p_data && audio_frame.no_channels >= 3) {
+					audio_decoder.push(
+						(const float*)((const uint8_t*)audio_frame.p_data +
+							       2 * audio_frame.channel_stride_in_bytes),
+						audio_frame.no_samples,
+						sync_type == SyncType::Code ? audio_frame.timecode * 100
+									    : audio_frame.timestamp * 100,
+						audio_frame.sample_rate);
+				}
+				NDIlib_framesync_free_audio(pNDI_framesync, &audio_frame);
+			}
+
+			NDIlib_video_frame_v2_t video_frame;
+			NDIlib_framesync_capture_video(pNDI_framesync, &video_frame);
+			uint32_t id;
+			if (video_frame.p_data &&
+			    (video_frame.FourCC == NDIlib_FourCC_type_UYVY ||
+			     video_frame.FourCC == NDIlib_FourCC_type_BGRA ||
+			     video_frame.FourCC == NDIlib_FourCC_type_BGRX) &&
+			    frame_code_read(video_frame.p_data, video_frame.xres, video_frame.yres,
+					    video_frame.line_stride_in_bytes,
+					    video_frame.FourCC == NDIlib_FourCC_type_UYVY,
+					    frame_code_corner, id) &&
+			    frame_code_next(id, have_video_id, last_video_id, video_drops)) {
+				telemetry_counters.frames++;
+				frame_code_seen(message, id,
+						sync_type == SyncType::Code ? video_frame.timecode * 100
+									    : video_frame.timestamp * 100,
+						true);
+			}
+			NDIlib_framesync_free_video(pNDI_framesync, &video_frame);
+			publish_telemetry();
+
+			// Poll well above the frame rate so no frame is missed
+			std::this_thread::sleep_for(milliseconds(2));
+			continue;
+		}
+
 		// Get audio samples
 		NDIlib_audio_frame_v2_t audio_frame;
 		NDIlib_framesync_capture_audio(pNDI_framesync, &audio_frame,
@@ -194,15 +335,17 @@ int main(int argc, char* argv[])
 			int frame_time = 1000000000 / (video_frame.frame_rate_N/video_frame.frame_rate_D);
 			if ((sync_type == SyncType::Code
 					    ? video_frame.timecode * 100
-					    : video_frame.timestamp) >
+					    : video_frame.timestamp * 100) >
 				last_timestamp + frame_time) {
+				telemetry_counters.frames++;
+				telemetry_counters.audio_blocks++;
 
 				obs_sync_debug_log_video_time(
 					message,
 					sync_type == SyncType::Code
 						? video_frame.timecode *
 								100
-						: video_frame.timestamp,
+						: video_frame.timestamp * 100,
 					video_frame.p_data);
 
 				obs_sync_debug_log_audio_time(
@@ -210,7 +353,7 @@ int main(int argc, char* argv[])
 					sync_type == SyncType::Code
 						? audio_frame.timecode *
 								100
-						: audio_frame.timestamp,
+						: audio_frame.timestamp * 100,
 					audio_frame.p_data,
 					audio_frame.no_samples,
 					audio_frame.sample_rate);
@@ -219,7 +362,7 @@ int main(int argc, char* argv[])
 					sync_type == SyncType::Code
 						? video_frame.timecode *
 								100
-						: video_frame.timestamp;
+						: video_frame.timestamp * 100;
 
 			}
 		}
@@ -228,6 +371,7 @@ int main(int argc, char* argv[])
 		NDIlib_framesync_free_audio(pNDI_framesync, &audio_frame);
 		// Release the video. You could keep the frame if you want and release it later.
 		NDIlib_framesync_free_video(pNDI_framesync, &video_frame);
+		publish_telemetry();
 
 		// This is our clock. We are going to run at 30Hz and the frame-sync is smart enough to
 		// best adapt the video and audio to match that.
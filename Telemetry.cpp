@@ -0,0 +1,221 @@
+#include "Telemetry.h"
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(TelemetryHeader) <= Telemetry::HEADER_SIZE,
+	      "header fits its page");
+
+// How often read() retries a slot the writer keeps busy
+static const int read_tries = 64;
+
+Telemetry::Telemetry()
+	: header_(nullptr),
+	  map_size_(0),
+	  owner_(false),
+#ifdef _WIN32
+	  mapping_(NULL)
+#else
+	  fd_(-1)
+#endif
+{
+}
+
+Telemetry::~Telemetry()
+{
+	close();
+}
+
+bool Telemetry::create(const char *process, uint32_t max_slots)
+{
+	close();
+	if (max_slots == 0)
+		max_slots = 1;
+	map_size_ = HEADER_SIZE + (size_t)max_slots * sizeof(TelemetrySlot);
+
+	void *p_map = nullptr;
+#ifdef _WIN32
+	const unsigned long pid = GetCurrentProcessId();
+	segment_ = "Local\\synctest." + std::string(process) + "." +
+		   std::to_string(pid);
+	mapping_ = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL,
+				      PAGE_READWRITE, 0, (DWORD)map_size_,
+				      segment_.c_str());
+	if (mapping_)
+		p_map = MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, map_size_);
+#else
+	const unsigned long pid = (unsigned long)getpid();
+	segment_ = "/synctest." + std::string(process) + "." +
+		   std::to_string(pid);
+	fd_ = shm_open(segment_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd_ < 0)
+		return false;
+	if (ftruncate(fd_, (off_t)map_size_) == 0) {
+		p_map = mmap(NULL, map_size_, PROT_READ | PROT_WRITE,
+			     MAP_SHARED, fd_, 0);
+		if (p_map == MAP_FAILED)
+			p_map = nullptr;
+	}
+#endif
+	owner_ = true;
+	if (!p_map) {
+		close();
+		return false;
+	}
+
+	// New shared memory is zero filled: every slot reads as empty
+	header_ = (TelemetryHeader *)p_map;
+	header_->header_size = (uint32_t)HEADER_SIZE;
+	header_->slot_size = (uint32_t)sizeof(TelemetrySlot);
+	header_->max_slots = max_slots;
+	header_->pid = (uint32_t)pid;
+	strncpy(header_->process, process, sizeof(header_->process) - 1);
+	// Monitors check the magic last
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(header_->magic, "SYNCTEL1", 8);
+	return true;
+}
+
+bool Telemetry::attach(const std::string &segment)
+{
+	close();
+	segment_ = segment;
+
+	void *p_map = nullptr;
+#ifdef _WIN32
+	mapping_ = OpenFileMappingA(FILE_MAP_READ, FALSE, segment_.c_str());
+	if (mapping_)
+		p_map = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+	if (p_map) {
+		MEMORY_BASIC_INFORMATION info;
+		VirtualQuery(p_map, &info, sizeof(info));
+		map_size_ = info.RegionSize;
+	}
+#else
+	fd_ = shm_open(segment_.c_str(), O_RDONLY, 0);
+	if (fd_ < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd_, &st) == 0 && (size_t)st.st_size >= HEADER_SIZE) {
+		map_size_ = (size_t)st.st_size;
+		p_map = mmap(NULL, map_size_, PROT_READ, MAP_SHARED, fd_, 0);
+		if (p_map == MAP_FAILED)
+			p_map = nullptr;
+	}
+#endif
+	header_ = (TelemetryHeader *)p_map;
+	if (!header_ || memcmp(header_->magic, "SYNCTEL1", 8) != 0 ||
+	    header_->slot_size != sizeof(TelemetrySlot) ||
+	    HEADER_SIZE + (size_t)header_->max_slots * sizeof(TelemetrySlot) >
+		    map_size_) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void Telemetry::close()
+{
+#ifdef _WIN32
+	if (header_)
+		UnmapViewOfFile(header_);
+	if (mapping_)
+		CloseHandle(mapping_);
+	mapping_ = NULL;
+#else
+	if (header_)
+		munmap(header_, map_size_);
+	if (fd_ >= 0)
+		::close(fd_);
+	if (owner_)
+		shm_unlink(segment_.c_str());
+	fd_ = -1;
+#endif
+	header_ = nullptr;
+	owner_ = false;
+}
+
+TelemetrySlot *Telemetry::add(const std::string &name)
+{
+	if (!header_ || !owner_)
+		return nullptr;
+	const uint32_t index = header_->slots.load(std::memory_order_relaxed);
+	if (index >= header_->max_slots)
+		return nullptr;
+
+	TelemetrySlot *slot =
+		(TelemetrySlot *)((uint8_t *)header_ + HEADER_SIZE) + index;
+	strncpy(slot->name, name.c_str(), sizeof(slot->name) - 1);
+	// The name is in place before monitors see the slot
+	header_->slots.store(index + 1, std::memory_order_release);
+	return slot;
+}
+
+const TelemetrySlot *Telemetry::slot(uint32_t index) const
+{
+	if (!header_ ||
+	    index >= header_->slots.load(std::memory_order_acquire))
+		return nullptr;
+	return (const TelemetrySlot *)((const uint8_t *)header_ +
+				       HEADER_SIZE) +
+	       index;
+}
+
+void Telemetry::publish(TelemetrySlot &slot, const TelemetryCounters &counters)
+{
+	uint64_t words[TELEMETRY_VALUES];
+	memcpy(words, &counters, sizeof(words));
+
+	// Odd sequence: readers that see it, or see it change, retry
+	const uint64_t sequence =
+		slot.sequence.load(std::memory_order_relaxed);
+	slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (int i = 0; i < TELEMETRY_VALUES; ++i)
+		slot.values[i].store(words[i], std::memory_order_relaxed);
+	slot.updated_ns.store(
+		(uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch())
+			.count(),
+		std::memory_order_relaxed);
+
+	slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool Telemetry::read(const TelemetrySlot &slot, TelemetryCounters &counters,
+		     uint64_t *updated_ns)
+{
+	uint64_t words[TELEMETRY_VALUES];
+	for (int tries = 0; tries < read_tries; ++tries) {
+		const uint64_t before =
+			slot.sequence.load(std::memory_order_acquire);
+		if (before & 1)
+			continue;
+
+		for (int i = 0; i < TELEMETRY_VALUES; ++i)
+			words[i] = slot.values[i].load(
+				std::memory_order_relaxed);
+		const uint64_t updated =
+			slot.updated_ns.load(std::memory_order_relaxed);
+
+		// The loads above complete before the sequence is checked
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != before)
+			continue;
+
+		memcpy(&counters, words, sizeof(words));
+		if (updated_ns)
+			*updated_ns = updated;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Live counters of a process in a named shared-memory segment, for monitors
+// that poll many senders and receivers without talking to them.
+//
+// The segment is a 256 byte TelemetryHeader followed by max_slots
+// TelemetrySlots, one per stream. Each slot has a single writer and is
+// guarded by a seqlock: the writer makes the sequence odd, stores the
+// counters and makes it even again, and a reader retries while the sequence
+// is odd or has changed under it. Publishing is a few dozen plain stores, so
+// the send loop neither blocks nor makes a system call, and readers never
+// hold the writer up however often they poll.
+//
+// Segments are named synctest.<process>.<pid>: /dev/shm/synctest.send.1234
+// on Linux, Local\synctest.send.1234 on Windows.
+
+static constexpr int TELEMETRY_BUCKETS = 16;
+
+// One consistent reading of a slot. Fields a process does not track stay 0.
+struct TelemetryCounters {
+	uint64_t frames;         // video frames sent or received
+	uint64_t audio_blocks;   // audio frames sent or received
+	uint64_t late_frames;    // sent a millisecond or more after the deadline
+	uint64_t skipped_frames; // skipped by the pacer after a stall
+	int64_t connections;     // receivers connected, -1 if unknown
+	uint64_t video_drops;    // frame codes missing in video
+	uint64_t audio_drops;    // frame codes missing in audio
+	int64_t av_offset_ns;    // last measured video - audio offset
+	// Late-wake histogram of the sender's pacer (FramePacer buckets)
+	uint64_t late_wake[TELEMETRY_BUCKETS];
+};
+
+static constexpr int TELEMETRY_VALUES =
+	(int)(sizeof(TelemetryCounters) / sizeof(uint64_t));
+static_assert(sizeof(TelemetryCounters) % sizeof(uint64_t) == 0,
+	      "counters are 64-bit words");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+	      "slots are shared between processes");
+
+struct alignas(64) TelemetrySlot {
+	std::atomic<uint64_t> sequence; // odd while the writer is storing
+	std::atomic<uint64_t> updated_ns; // steady clock of the last publish
+	char name[64];                    // stream name, set once
+	std::atomic<uint64_t> values[TELEMETRY_VALUES];
+};
+
+struct TelemetryHeader {
+	char magic[8]; // "SYNCTEL1"
+	uint32_t header_size;
+	uint32_t slot_size;
+	uint32_t max_slots;
+	uint32_t pid;
+	std::atomic<uint32_t> slots; // slots in use
+	uint32_t reserved;
+	char process[32]; // "send" or "receive"
+};
+
+class Telemetry {
+public:
+	static constexpr size_t HEADER_SIZE = 256;
+	// Frames this late or later count as late_frames
+	static constexpr int64_t LATE_NS = 1000000;
+
+	Telemetry();
+	~Telemetry();
+
+	Telemetry(const Telemetry &) = delete;
+	Telemetry &operator=(const Telemetry &) = delete;
+
+	// Create this process's segment with room for max_slots streams.
+	// Returns false if it cannot be created.
+	bool create(const char *process, uint32_t max_slots);
+	// Map another process's segment read-only, by its name
+	bool attach(const std::string &segment);
+	void close();
+	bool is_open() const { return header_ != nullptr; }
+	const std::string &segment_name() const { return segment_; }
+
+	// Claim the next slot for stream name, or nullptr when all are taken.
+	// Call before the slot's writer starts.
+	TelemetrySlot *add(const std::string &name);
+
+	const TelemetryHeader *header() const { return header_; }
+	const TelemetrySlot *slot(uint32_t index) const;
+
+	// Store counters in slot; only the slot's one writer thread may call
+	static void publish(TelemetrySlot &slot,
+			    const TelemetryCounters &counters);
+	// Copy a consistent set of counters out of slot. Returns false if the
+	// writer was storing on every try.
+	static bool read(const TelemetrySlot &slot, TelemetryCounters &counters,
+			 uint64_t *updated_ns = nullptr);
+
+private:
+	TelemetryHeader *header_;
+	size_t map_size_;
+	bool owner_;
+	std::string segment_;
+#ifdef _WIN32
+	void *mapping_;
+#else
+	int fd_;
+#endif
+};
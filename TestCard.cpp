@@ -0,0 +1,235 @@
+#include "TestCard.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include "FillKernels.h"
+
+bool parse_color_matrix(const char *name, ColorMatrix &matrix)
+{
+	if (strcmp(name, "auto") == 0) {
+		matrix = ColorMatrix::Auto;
+	} else if (strcmp(name, "601") == 0) {
+		matrix = ColorMatrix::BT601;
+	} else if (strcmp(name, "709") == 0) {
+		matrix = ColorMatrix::BT709;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+CardFlashRect card_flash_rect(int xres, int yres)
+{
+	// Whole chroma pairs, so the flash never shares a pair with the card
+	return {0, 0, std::max(xres / 4 / 2 * 2, 2), std::max(yres / 4, 1)};
+}
+
+static uint32_t read_u16(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+	return read_u16(p) | (read_u16(p + 2) << 16);
+}
+
+std::shared_ptr<const TestCard> TestCard::load(const std::string &path,
+					       int raw_width, int raw_height)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("Could not open test card: " + path);
+	const std::vector<uint8_t> bytes(
+		(std::istreambuf_iterator<char>(file)),
+		std::istreambuf_iterator<char>());
+
+	std::shared_ptr<TestCard> card(new TestCard());
+	card->path_ = path;
+
+	if (bytes.size() >= 54 && bytes[0] == 'B' && bytes[1] == 'M') {
+		// BITMAPFILEHEADER, then BITMAPINFOHEADER or a later version
+		const uint32_t offset = read_u32(&bytes[10]);
+		const int32_t width = (int32_t)read_u32(&bytes[18]);
+		const int32_t height = (int32_t)read_u32(&bytes[22]);
+		const uint32_t bpp = read_u16(&bytes[28]);
+		const uint32_t compression = read_u32(&bytes[30]);
+		// BI_RGB, or BI_BITFIELDS in the usual BGRA order
+		if ((bpp != 24 && bpp != 32) ||
+		    !(compression == 0 || (compression == 3 && bpp == 32)) ||
+		    width <= 0 || height == 0)
+			throw std::runtime_error(
+				"Test card is not a 24 or 32-bit "
+				"uncompressed BMP: " +
+				path);
+
+		const int w = width;
+		const int h = std::abs(height);
+		const size_t stride = ((size_t)w * bpp / 8 + 3) / 4 * 4;
+		if (offset + stride * h > bytes.size())
+			throw std::runtime_error("Test card is truncated: " +
+						 path);
+
+		// Positive heights are stored bottom row first
+		card->pixels_.resize((size_t)w * h);
+		for (int row = 0; row < h; ++row) {
+			const uint8_t *src = &bytes[offset] +
+					     stride * (height > 0 ? h - 1 - row
+								  : row);
+			uint32_t *dst = &card->pixels_[(size_t)row * w];
+			for (int x = 0; x < w; ++x, src += bpp / 8)
+				dst[x] = src[2] | (src[1] << 8) |
+					 (src[0] << 16);
+		}
+		card->width_ = w;
+		card->height_ = h;
+		return card;
+	}
+
+	if (raw_width <= 0 || raw_height <= 0)
+		throw std::runtime_error(
+			"Raw RGB test card needs -card_size=WxH: " + path);
+	const size_t pixels = (size_t)raw_width * raw_height;
+	if (bytes.size() != pixels * 3)
+		throw std::runtime_error("Raw RGB test card is not " +
+					 std::to_string(raw_width) + "x" +
+					 std::to_string(raw_height) + ": " +
+					 path);
+	card->pixels_.resize(pixels);
+	for (size_t i = 0; i < pixels; ++i)
+		card->pixels_[i] = bytes[3 * i] | (bytes[3 * i + 1] << 8) |
+				   (bytes[3 * i + 2] << 16);
+	card->width_ = raw_width;
+	card->height_ = raw_height;
+	return card;
+}
+
+// Q12 coefficients for luma weights kr, kb. Rows are rounded so that white
+// lands exactly on 940 and grays on neutral chroma.
+static YcbcrCoeffs ycbcr_coeffs(double kr, double kb)
+{
+	const double kg = 1.0 - kr - kb;
+	const double y_scale = 876.0 / 255.0 * 4096.0;
+	const double c_scale = 896.0 / 255.0 * 4096.0;
+
+	YcbcrCoeffs coeffs;
+	const int y_sum = (int)std::lround(y_scale);
+	coeffs.y[0] = (int16_t)std::lround(kr * y_scale);
+	coeffs.y[2] = (int16_t)std::lround(kb * y_scale);
+	coeffs.y[1] = (int16_t)(y_sum - coeffs.y[0] - coeffs.y[2]);
+
+	coeffs.cb[0] = (int16_t)std::lround(-kr / (2 * (1 - kb)) * c_scale);
+	coeffs.cb[1] = (int16_t)std::lround(-kg / (2 * (1 - kb)) * c_scale);
+	coeffs.cb[2] = (int16_t)(-coeffs.cb[0] - coeffs.cb[1]);
+
+	coeffs.cr[1] = (int16_t)std::lround(-kg / (2 * (1 - kr)) * c_scale);
+	coeffs.cr[2] = (int16_t)std::lround(-kb / (2 * (1 - kr)) * c_scale);
+	coeffs.cr[0] = (int16_t)(-coeffs.cr[1] - coeffs.cr[2]);
+	return coeffs;
+}
+
+// Chroma of the pair starting at even pixel x, co-sited with it, times 4
+static inline int cosited4(const int16_t *c, int x, int xres)
+{
+	const int left = c[x > 0 ? x - 1 : 0];
+	const int right = c[x + 1 < xres ? x + 1 : x];
+	return left + 2 * c[x] + right;
+}
+
+void TestCard::render_rows(const FrameLayout &layout, ColorMatrix matrix,
+			   uint8_t *p_data, int first_row, int last_row) const
+{
+	const int xres = layout.xres;
+	const int yres = layout.yres;
+	if (matrix == ColorMatrix::Auto)
+		matrix = yres >= 720 ? ColorMatrix::BT709 : ColorMatrix::BT601;
+	const YcbcrCoeffs coeffs = matrix == ColorMatrix::BT709
+					   ? ycbcr_coeffs(0.2126, 0.0722)
+					   : ycbcr_coeffs(0.299, 0.114);
+
+	// One scaled card row and its samples; bands render in parallel, so
+	// each call has its own
+	std::vector<uint32_t> rgbx(xres);
+	std::vector<int16_t> y(xres), cb(xres), cr(xres);
+	const size_t pixels = (size_t)xres * yres;
+
+	for (int row = first_row; row < last_row; ++row) {
+		const uint32_t *src =
+			&pixels_[(size_t)((int64_t)row * height_ / yres) *
+				 width_];
+		for (int x = 0; x < xres; ++x)
+			rgbx[x] = src[(int64_t)x * width_ / xres];
+
+		switch (layout.fourcc) {
+		case NDIlib_FourCC_type_BGRA:
+		case NDIlib_FourCC_type_BGRX: {
+			uint32_t *dst =
+				(uint32_t *)(p_data + row * layout.line_stride);
+			for (int x = 0; x < xres; ++x)
+				dst[x] = 0xFF000000u |
+					 ((rgbx[x] & 0xFF) << 16) |
+					 (rgbx[x] & 0xFF00) |
+					 ((rgbx[x] >> 16) & 0xFF);
+			break;
+		}
+		case NDIlib_FourCC_type_RGBA:
+		case NDIlib_FourCC_type_RGBX: {
+			uint32_t *dst =
+				(uint32_t *)(p_data + row * layout.line_stride);
+			for (int x = 0; x < xres; ++x)
+				dst[x] = 0xFF000000u | rgbx[x];
+			break;
+		}
+		case NDIlib_FourCC_type_P216:
+		case NDIlib_FourCC_type_PA16: {
+			rgb_to_ycbcr12(rgbx.data(), y.data(), cb.data(),
+				       cr.data(), xres, coeffs);
+			// 10-bit samples in the top bits
+			uint16_t *dst_y =
+				(uint16_t *)(p_data + row * layout.line_stride);
+			uint16_t *dst_uv = dst_y + pixels;
+			for (int x = 0; x < xres; ++x)
+				dst_y[x] = (uint16_t)(((y[x] + 2) >> 2) << 6);
+			for (int x = 0; x + 1 < xres; x += 2) {
+				dst_uv[x] = (uint16_t)(
+					((cosited4(cb.data(), x, xres) + 8) >>
+					 4)
+					<< 6);
+				dst_uv[x + 1] = (uint16_t)(
+					((cosited4(cr.data(), x, xres) + 8) >>
+					 4)
+					<< 6);
+			}
+			if (layout.fourcc == NDIlib_FourCC_type_PA16)
+				fill_pattern32((uint8_t *)(dst_y + 2 * pixels),
+					       (size_t)xres * 2, 0xFFC0FFC0u);
+			break;
+		}
+		case NDIlib_FourCC_type_UYVY:
+		case NDIlib_FourCC_type_UYVA:
+		default: {
+			rgb_to_ycbcr12(rgbx.data(), y.data(), cb.data(),
+				       cr.data(), xres, coeffs);
+			uint8_t *dst = p_data + row * layout.line_stride;
+			for (int x = 0; x + 1 < xres; x += 2, dst += 4) {
+				dst[0] = (uint8_t)(
+					(cosited4(cb.data(), x, xres) + 32) >>
+					6);
+				dst[1] = (uint8_t)((y[x] + 8) >> 4);
+				dst[2] = (uint8_t)(
+					(cosited4(cr.data(), x, xres) + 32) >>
+					6);
+				dst[3] = (uint8_t)((y[x + 1] + 8) >> 4);
+			}
+			if (layout.fourcc == NDIlib_FourCC_type_UYVA)
+				memset(p_data + layout.plane1_size +
+					       (size_t)row * xres,
+				       0xFF, xres);
+			break;
+		}
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "FrameLayout.h"
+
+// Matrix for converting a card to Y'CbCr. Auto picks BT.709 for HD and
+// larger frames and BT.601 below 720 lines.
+enum class ColorMatrix { Auto, BT601, BT709 };
+
+// Parse "auto", "601" or "709". Returns false for anything else.
+bool parse_color_matrix(const char *name, ColorMatrix &matrix);
+
+// An RGB image shown behind the pattern instead of black: a 24 or 32-bit
+// uncompressed BMP (such as ImageExtractor's SaveRGBImageAsBMP writes) or a
+// headerless file of 8-bit R, G, B triplets. Streams scale it to their
+// resolution (nearest neighbour) and convert it to their FourCC once, when
+// it is rendered into a cached frame.
+class TestCard {
+public:
+	// Load path. Raw RGB files need their size in raw_width, raw_height;
+	// BMP files carry their own. Throws std::runtime_error if the file
+	// cannot be read.
+	static std::shared_ptr<const TestCard> load(const std::string &path,
+						    int raw_width = 0,
+						    int raw_height = 0);
+
+	int width() const { return width_; }
+	int height() const { return height_; }
+	const std::string &path() const { return path_; }
+
+	// Render rows [first_row, last_row) of the card, scaled to the frame,
+	// into a frame of layout. Y'CbCr formats are studio range; 4:2:2
+	// chroma is co-sited with the even luma sample, filtered 1-2-1 from
+	// the three pixels around it.
+	void render_rows(const FrameLayout &layout, ColorMatrix matrix,
+			 uint8_t *p_data, int first_row, int last_row) const;
+
+private:
+	TestCard() : width_(0), height_(0) {}
+
+	std::string path_;
+	int width_;
+	int height_;
+	std::vector<uint32_t> pixels_; // R | G << 8 | B << 16, top row first
+};
+
+// Where the sync flash is drawn over a card or clip: the top-left quarter,
+// which holds the pixel that receivers check for white
+struct CardFlashRect {
+	int x, y, w, h;
+};
+CardFlashRect card_flash_rect(int xres, int yres);
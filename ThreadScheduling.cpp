@@ -0,0 +1,291 @@
+#include "ThreadScheduling.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <avrt.h>
+#pragma comment(lib, "avrt.lib")
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <cerrno>
+#endif
+
+static const char *role_names[] = {"Send", "Render", "Audio"};
+
+bool parse_realtime_policy(const char *name, RealtimePolicy &policy)
+{
+	if (strcmp(name, "off") == 0)
+		policy = RealtimePolicy::Off;
+	else if (strcmp(name, "fifo") == 0)
+		policy = RealtimePolicy::Fifo;
+	else if (strcmp(name, "rr") == 0)
+		policy = RealtimePolicy::RoundRobin;
+	else
+		return false;
+	return true;
+}
+
+bool parse_cpu_list(const char *list, std::vector<int> &cpus)
+{
+	std::vector<int> parsed;
+	const char *p = list;
+	for (;;) {
+		char *end;
+		const long first = strtol(p, &end, 10);
+		if (end == p || first < 0)
+			return false;
+		long last = first;
+		p = end;
+		if (*p == '-') {
+			last = strtol(p + 1, &end, 10);
+			if (end == p + 1 || last < first)
+				return false;
+			p = end;
+		}
+		for (long cpu = first; cpu <= last; ++cpu)
+			parsed.push_back((int)cpu);
+		if (*p == 0)
+			break;
+		if (*p++ != ',')
+			return false;
+	}
+	cpus = parsed;
+	return true;
+}
+
+// Pin the calling thread to one logical CPU. Returns false if the OS
+// refused.
+static bool pin_current_thread(int cpu)
+{
+#ifdef _WIN32
+	return SetThreadAffinityMask(GetCurrentThread(),
+				     (DWORD_PTR)1 << (cpu % 64)) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu % CPU_SETSIZE, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	(void)cpu;
+	return false;
+#endif
+}
+
+// "1,4-7" for {1, 4, 5, 6, 7}
+static std::string format_cpus(const std::set<int> &cpus)
+{
+	std::string text;
+	for (auto it = cpus.begin(); it != cpus.end();) {
+		const int first = *it;
+		int last = first;
+		while (++it != cpus.end() && *it == last + 1)
+			last = *it;
+		if (!text.empty())
+			text += ",";
+		text += std::to_string(first);
+		if (last > first)
+			text += "-" + std::to_string(last);
+	}
+	return text;
+}
+
+ThreadScheduling &ThreadScheduling::instance()
+{
+	static ThreadScheduling scheduling;
+	return scheduling;
+}
+
+ThreadScheduling::ThreadScheduling()
+{
+	for (Granted &granted : granted_) {
+		granted.next_cpu = 0;
+		granted.any_cpu = false;
+	}
+}
+
+void ThreadScheduling::configure(const SchedulingParams &params)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	params_ = params;
+#ifdef _WIN32
+	// Thread priorities, MMCSS aside, are relative to the class
+	SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
+#endif
+}
+
+int ThreadScheduling::role_priority(const SchedulingParams &params,
+				    ThreadRole role)
+{
+	return role == ThreadRole::Render ? params.priority - 1
+					  : params.priority;
+}
+
+std::string ThreadScheduling::apply_policy(const SchedulingParams &params,
+					   ThreadRole role)
+{
+#ifdef _WIN32
+	std::string granted;
+	const HANDLE thread = GetCurrentThread();
+	if (params.policy != RealtimePolicy::Off) {
+		// MMCSS lifts a registered thread into the real-time range for
+		// as long as it runs; it has no FIFO/RR distinction and its own
+		// priority levels. The registration ends with the thread.
+		const char *task = role == ThreadRole::Audio ? "Pro Audio"
+							     : "Playback";
+		DWORD task_index = 0;
+		const HANDLE mmcss =
+			AvSetMmThreadCharacteristicsA(task, &task_index);
+		const bool render = role == ThreadRole::Render;
+		if (mmcss) {
+			AvSetMmThreadPriority(mmcss,
+					      render ? AVRT_PRIORITY_NORMAL
+						     : AVRT_PRIORITY_HIGH);
+			granted = std::string("MMCSS ") + task + ", ";
+		} else {
+			granted = "MMCSS refused (error " +
+				  std::to_string(GetLastError()) + "), ";
+			const int priority =
+				render ? THREAD_PRIORITY_ABOVE_NORMAL
+				       : THREAD_PRIORITY_TIME_CRITICAL;
+			SetThreadPriority(thread, priority);
+		}
+	} else if (role != ThreadRole::Render) {
+		SetThreadPriority(thread, THREAD_PRIORITY_HIGHEST);
+	}
+	return granted + "priority " +
+	       std::to_string(GetThreadPriority(thread));
+#else
+	std::string refused;
+	if (params.policy != RealtimePolicy::Off) {
+		const int policy = params.policy == RealtimePolicy::Fifo
+					   ? SCHED_FIFO
+					   : SCHED_RR;
+		sched_param param = {};
+		param.sched_priority =
+			std::max(sched_get_priority_min(policy),
+				 std::min(role_priority(params, role),
+					  sched_get_priority_max(policy)));
+		const int err = pthread_setschedparam(pthread_self(), policy,
+						      &param);
+		if (err != 0)
+			refused = std::string(" (") +
+				  (policy == SCHED_FIFO ? "SCHED_FIFO"
+							: "SCHED_RR") +
+				  " refused: " + strerror(err) + ")";
+	}
+
+	// Report what is in effect, not what was asked for
+	int policy = SCHED_OTHER;
+	sched_param param = {};
+	pthread_getschedparam(pthread_self(), &policy, &param);
+	if (policy == SCHED_FIFO)
+		return "SCHED_FIFO " + std::to_string(param.sched_priority);
+	if (policy == SCHED_RR)
+		return "SCHED_RR " + std::to_string(param.sched_priority);
+	return "SCHED_OTHER" + refused;
+#endif
+}
+
+void ThreadScheduling::apply(ThreadRole role)
+{
+	// params_ only changes before the first thread starts
+	const std::vector<int> &cpus =
+		role == ThreadRole::Send     ? params_.send_cpus
+		: role == ThreadRole::Render ? params_.render_cpus
+					     : params_.audio_cpus;
+	int cpu = -1;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		Granted &granted = granted_[(int)role];
+		if (!cpus.empty()) {
+			cpu = cpus[granted.next_cpu++ % cpus.size()];
+		} else if (role == ThreadRole::Render) {
+			// Leave the first core to the thread that calls
+			// RenderPool::run()
+			const unsigned count =
+				std::thread::hardware_concurrency();
+			if (count > 1)
+				cpu = 1 + granted.next_cpu++ % (count - 1);
+		}
+	}
+
+	const bool pinned = cpu >= 0 && pin_current_thread(cpu);
+	std::string policy = apply_policy(params_, role);
+	if (cpu >= 0 && !pinned)
+		policy += ", not pinned";
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	Granted &granted = granted_[(int)role];
+	++granted.policies[policy];
+	if (pinned)
+		granted.cpus.insert(cpu);
+	else
+		granted.any_cpu = true;
+}
+
+bool ThreadScheduling::lock_memory(size_t working_set)
+{
+	if (!params_.lock_memory)
+		return true;
+
+#ifdef _WIN32
+	// Windows has no mlockall(). Pages within a hard minimum working set
+	// are never trimmed, so guarantee the frame buffers plus headroom for
+	// code, stacks and the SDK. Large-page buffers are locked anyway.
+	const SIZE_T minimum = (SIZE_T)working_set + 256 * 1024 * 1024;
+	const DWORD flags = QUOTA_LIMITS_HARDWS_MIN_ENABLE |
+			    QUOTA_LIMITS_HARDWS_MAX_DISABLE;
+	const bool locked = SetProcessWorkingSetSizeEx(GetCurrentProcess(),
+						       minimum, minimum * 2,
+						       flags) != 0;
+	const std::string outcome =
+		locked ? std::to_string(minimum >> 20) +
+				 " MB working set locked"
+		       : "not locked (SetProcessWorkingSetSizeEx error " +
+				 std::to_string(GetLastError()) + ")";
+#else
+	(void)working_set;
+	// Needs CAP_IPC_LOCK or an RLIMIT_MEMLOCK (ulimit -l) that covers the
+	// process. Buffers mapped later are locked as they are mapped, and
+	// fail to map once the limit is reached.
+	const bool locked = mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+	const std::string outcome =
+		locked ? "locked"
+		       : std::string("not locked (mlockall: ") +
+				 strerror(errno) + ")";
+#endif
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	memory_ = outcome;
+	return locked;
+}
+
+void ThreadScheduling::report(std::ostream &out) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (int role = 0; role < 3; ++role) {
+		const Granted &granted = granted_[role];
+		if (granted.policies.empty())
+			continue;
+		out << role_names[role] << " threads:";
+		const char *separator = " ";
+		for (const auto &policy : granted.policies) {
+			out << separator << policy.second << " at "
+			    << policy.first;
+			separator = "; ";
+		}
+		if (!granted.cpus.empty())
+			out << "; CPUs " << format_cpus(granted.cpus);
+		if (granted.any_cpu)
+			out << (granted.cpus.empty() ? "; any CPU"
+						     : " and any CPU");
+		out << std::endl;
+	}
+	if (!memory_.empty())
+		out << "Memory: " << memory_ << std::endl;
+}
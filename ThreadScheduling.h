@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+// What a thread of the sender does, for picking its cores and priority
+enum class ThreadRole { Send, Render, Audio };
+
+// Scheduling policy asked for the send, render and audio threads
+enum class RealtimePolicy {
+	Off,        // normal threads; send and audio at highest on Windows
+	Fifo,       // SCHED_FIFO on Linux, MMCSS on Windows
+	RoundRobin, // SCHED_RR on Linux, MMCSS on Windows
+};
+
+struct SchedulingParams {
+	RealtimePolicy policy = RealtimePolicy::Off;
+	// SCHED_FIFO/SCHED_RR priority of send and audio threads; render
+	// threads get one less so they never preempt a send
+	int priority = 80;
+	// Cores for the threads of each role, dealt out one per thread in
+	// start order. Empty leaves send and audio threads unpinned and
+	// spreads render threads over all cores but the first.
+	std::vector<int> send_cpus;
+	std::vector<int> render_cpus;
+	std::vector<int> audio_cpus;
+	bool lock_memory = false; // keep the process resident
+};
+
+// Parse off, fifo or rr. Returns false on anything else.
+bool parse_realtime_policy(const char *name, RealtimePolicy &policy);
+// Parse a comma-separated list of cores and ranges, e.g. 2,3,8-11.
+// Returns false on a malformed list.
+bool parse_cpu_list(const char *list, std::vector<int> &cpus);
+
+// Pins and prioritizes the sender's threads.
+//
+// main() configures it once, before any thread starts; every send, render
+// and audio thread then calls apply() first thing. What each thread was
+// actually granted is read back from the OS and collected, so report() can
+// show when the real-time policy or a core was refused (SCHED_FIFO needs
+// CAP_SYS_NICE or an RLIMIT_RTPRIO, MMCSS needs the Multimedia Class
+// Scheduler service).
+class ThreadScheduling {
+public:
+	// The process-wide settings
+	static ThreadScheduling &instance();
+
+	// Store params and raise the process priority class on Windows
+	void configure(const SchedulingParams &params);
+
+	// Pin the calling thread to the next core of its role and apply the
+	// policy
+	void apply(ThreadRole role);
+
+	// Lock the pages the process has mapped, and with mlockall() every
+	// page it maps later, so frame buffers are never paged out.
+	// working_set is the Windows working set to guarantee. Does nothing
+	// without lock_memory; returns false if the lock was refused.
+	bool lock_memory(size_t working_set);
+
+	// Write what each role's threads were granted, and the memory lock
+	void report(std::ostream &out) const;
+
+private:
+	ThreadScheduling();
+
+	ThreadScheduling(const ThreadScheduling &) = delete;
+	ThreadScheduling &operator=(const ThreadScheduling &) = delete;
+
+	struct Granted {
+		int next_cpu;                      // round-robin over the list
+		std::map<std::string, int> policies; // policy -> threads
+		std::set<int> cpus;                // union of the affinities
+		bool any_cpu;                      // a thread was left unpinned
+	};
+
+	static int role_priority(const SchedulingParams &params,
+				 ThreadRole role);
+	static std::string apply_policy(const SchedulingParams &params,
+					ThreadRole role);
+
+	mutable std::mutex mutex_;
+	SchedulingParams params_;
+	Granted granted_[3]; // by ThreadRole
+	std::string memory_; // outcome of lock_memory(), empty if not asked
+};
@@ -0,0 +1,61 @@
+#include "Timebase.h"
+#include "PlatformTime.h"
+
+static const uint64_t ns_per_sec = 1000000000ULL;
+
+Timebase::Timebase(int frame_rate_N, int frame_rate_D, int sample_rate)
+	: rate_N_(frame_rate_N > 0 ? (uint64_t)frame_rate_N : 30000),
+	  rate_D_(frame_rate_N > 0 && frame_rate_D > 0 ? (uint64_t)frame_rate_D
+						       : 1000),
+	  sample_rate_((uint64_t)sample_rate),
+	  min_samples_(0),
+	  max_samples_(0)
+{
+	// Whole frames have sample_rate * D / N samples, rounded up or down
+	const uint64_t samples = sample_rate_ * rate_D_;
+	min_samples_ = (int)(samples / rate_N_);
+	max_samples_ = (int)((samples + rate_N_ - 1) / rate_N_);
+}
+
+uint64_t Timebase::frame_time_ns(uint64_t n) const
+{
+	return util_mul_div64(n, ns_per_sec * rate_D_, rate_N_);
+}
+
+uint64_t Timebase::frame_at(uint64_t time_ns) const
+{
+	// The inverse of frame_time_ns: the last frame starting at or before
+	// time_ns
+	uint64_t n = util_mul_div64(time_ns, rate_N_, ns_per_sec * rate_D_);
+	while (frame_time_ns(n + 1) <= time_ns)
+		++n;
+	while (n > 0 && frame_time_ns(n) > time_ns)
+		--n;
+	return n;
+}
+
+uint64_t Timebase::first_sample(uint64_t n) const
+{
+	return util_mul_div64(n, sample_rate_ * rate_D_, rate_N_);
+}
+
+uint64_t Timebase::frame_of_sample(uint64_t s) const
+{
+	// The inverse of first_sample: the last frame starting at or before s
+	uint64_t n = util_mul_div64(s, rate_N_, sample_rate_ * rate_D_);
+	while (first_sample(n + 1) <= s)
+		++n;
+	while (n > 0 && first_sample(n) > s)
+		--n;
+	return n;
+}
+
+uint64_t Timebase::sample_time_ns(uint64_t s) const
+{
+	return util_mul_div64(s, ns_per_sec, sample_rate_);
+}
+
+double Timebase::frame_duration_ns() const
+{
+	return (double)ns_per_sec * (double)rate_D_ / (double)rate_N_;
+}
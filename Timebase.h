@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// Exact times and audio sample positions of the frames of a stream with a
+// rational frame rate. Everything is computed from the frame number with
+// 128-bit intermediates rather than accumulated, so nothing drifts however
+// long the stream runs: at 30000/1001 and 48 kHz frames get 1601 or 1602
+// samples in a cadence that adds up to exactly 8008 every 5 frames.
+class Timebase {
+public:
+	Timebase(int frame_rate_N, int frame_rate_D, int sample_rate);
+
+	// Start of frame n in ns, rounded down
+	uint64_t frame_time_ns(uint64_t n) const;
+	// Number of the frame that contains time_ns
+	uint64_t frame_at(uint64_t time_ns) const;
+
+	// Index of the first audio sample of frame n
+	uint64_t first_sample(uint64_t n) const;
+	// Audio samples that belong to frame n
+	int samples_in_frame(uint64_t n) const
+	{
+		return (int)(first_sample(n + 1) - first_sample(n));
+	}
+	// Number of the frame that audio sample s belongs to
+	uint64_t frame_of_sample(uint64_t s) const;
+	// Time of audio sample s in ns, rounded down
+	uint64_t sample_time_ns(uint64_t s) const;
+	// The fewest and the most samples any frame gets
+	int min_samples_per_frame() const { return min_samples_; }
+	int max_samples_per_frame() const { return max_samples_; }
+
+	// Average frame duration in ns, for display only
+	double frame_duration_ns() const;
+	int sample_rate() const { return (int)sample_rate_; }
+	uint64_t rate_N() const { return rate_N_; }
+	uint64_t rate_D() const { return rate_D_; }
+
+private:
+	uint64_t rate_N_;
+	uint64_t rate_D_;
+	uint64_t sample_rate_;
+	int min_samples_;
+	int max_samples_;
+};
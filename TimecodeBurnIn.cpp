@@ -0,0 +1,149 @@
+#include "TimecodeBurnIn.h"
+#include <algorithm>
+#include <cstring>
+#include "FillKernels.h"
+
+static const uint64_t ns_per_sec = 1000000000ULL;
+
+// 5x7 glyphs, one byte per row with the leftmost column in bit 4, in the
+// order of glyph_chars
+static const char glyph_chars[] = "0123456789: ";
+static const int glyph_count = sizeof(glyph_chars) - 1;
+static const uint8_t glyphs[glyph_count][7] = {
+	{0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E},
+	{0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E},
+	{0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F},
+	{0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E},
+	{0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02},
+	{0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E},
+	{0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E},
+	{0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},
+	{0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E},
+	{0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C},
+	{0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00},
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+};
+
+// A glyph fills 5 of the 6 columns and 7 of the 9 rows of its cell
+static const int cell_columns = 6;
+static const int cell_rows = 9;
+
+static int glyph_index(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	return c == ':' ? 10 : 11;
+}
+
+TimecodeBurnIn::TimecodeBurnIn()
+	: layout_(),
+	  atlas_layout_(),
+	  frame_rate_N_(30),
+	  frame_rate_D_(1),
+	  cell_w_(0),
+	  cell_h_(0),
+	  x_(0),
+	  y_(0)
+{
+}
+
+bool TimecodeBurnIn::init(const FrameLayout &layout, int frame_rate_N,
+			  int frame_rate_D, uint32_t white, uint32_t black,
+			  bool top, int buffers)
+{
+	layout_ = layout;
+	frame_rate_N_ = frame_rate_N;
+	frame_rate_D_ = std::max(frame_rate_D, 1);
+
+	// Glyph pixels are scale x scale squares, even so that every square
+	// covers whole chroma pairs. The text takes at most half the width,
+	// so it stays clear of the flash in the top-left quarter.
+	const int text_columns = TEXT_LENGTH * cell_columns;
+	const int scale = std::min(layout.yres / 180,
+				   layout.xres / 2 / text_columns) &
+			  ~1;
+	if (scale < 2)
+		return false;
+	cell_w_ = cell_columns * scale;
+	cell_h_ = cell_rows * scale;
+	const int margin = 2 * scale;
+	x_ = (layout.xres - margin - TEXT_LENGTH * cell_w_) & ~1;
+	y_ = top ? margin : layout.yres - margin - cell_h_;
+
+	atlas_layout_ =
+		get_frame_layout(layout.fourcc, cell_w_, cell_h_ * glyph_count);
+	atlas_.assign(atlas_layout_.total_size, 0);
+	fill_rect(atlas_layout_, atlas_.data(), 0, 0, atlas_layout_.xres,
+		  atlas_layout_.yres, black);
+	for (int g = 0; g < glyph_count; ++g) {
+		for (int row = 0; row < 7; ++row) {
+			for (int col = 0; col < 5; ++col) {
+				if (glyphs[g][row] & (0x10 >> col))
+					fill_rect(atlas_layout_, atlas_.data(),
+						  col * scale,
+						  (g * cell_rows + 1 + row) *
+							  scale,
+						  scale, scale, white);
+			}
+		}
+	}
+
+	drawn_.assign(std::max(buffers, 1), std::vector<char>(TEXT_LENGTH, 0));
+	return true;
+}
+
+void TimecodeBurnIn::format(uint64_t frame_ns, int frame_rate_N,
+			    int frame_rate_D, uint32_t id,
+			    char (&text)[TEXT_LENGTH + 1])
+{
+	// Timestamps are whole ns, rounded down from the exact frame time, so
+	// split half a frame later: each frame then counts one past the one
+	// before, starting from 0 in every second, also at 29.97
+	const uint64_t half_frame_ns =
+		ns_per_sec * frame_rate_D / frame_rate_N / 2;
+	const uint64_t t = frame_ns + half_frame_ns;
+	const uint64_t seconds = t / ns_per_sec % 86400;
+	const uint64_t frames = t % ns_per_sec * frame_rate_N /
+				(ns_per_sec * frame_rate_D);
+
+	const uint64_t fields[4] = {seconds / 3600, seconds / 60 % 60,
+				    seconds % 60, frames % 100};
+	char *p = text;
+	*p++ = ' ';
+	for (int i = 0; i < 4; ++i) {
+		*p++ = (char)('0' + fields[i] / 10);
+		*p++ = (char)('0' + fields[i] % 10);
+		*p++ = i < 3 ? ':' : ' ';
+	}
+	for (int digit = 9; digit >= 0; --digit, id /= 10)
+		p[digit] = (char)('0' + id % 10);
+	text[TEXT_LENGTH] = 0;
+}
+
+void TimecodeBurnIn::draw(int slot, uint8_t *p_data, uint64_t frame_ns,
+			  uint32_t id)
+{
+	char text[TEXT_LENGTH + 1];
+	format(frame_ns, frame_rate_N_, frame_rate_D_, id, text);
+
+	std::vector<char> &drawn = drawn_[slot];
+	for (int i = 0; i < TEXT_LENGTH; ++i) {
+		if (drawn[i] == text[i])
+			continue;
+		blit_rect(layout_, p_data, x_ + i * cell_w_, y_, atlas_layout_,
+			  atlas_.data(), 0, glyph_index(text[i]) * cell_h_,
+			  cell_w_, cell_h_);
+		drawn[i] = text[i];
+	}
+}
+
+void TimecodeBurnIn::invalidate(int slot)
+{
+	std::fill(drawn_[slot].begin(), drawn_[slot].end(), 0);
+}
+
+bool TimecodeBurnIn::intersects(int x, int y, int w, int h) const
+{
+	return x < x_ + TEXT_LENGTH * cell_w_ && x + w > x_ &&
+	       y < y_ + cell_h_ && y + h > y_;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "FrameLayout.h"
+
+// Human-readable timecode burned into the picture, for latency measurements
+// with a camera pointed at the source and the receiver's display:
+//
+//   HH:MM:SS:FF 0000001234
+//
+// HH:MM:SS is the time of day of the frame's timestamp (UTC with -ntp) and
+// FF the frame within that second, then the frame ID of the frame code.
+//
+// Digits, colons and spaces are rasterized once, in the stream's FourCC,
+// into an atlas of cells with a black background. Each buffer remembers
+// the text it holds, and drawing a frame copies only the cells whose
+// character changed, which is usually just the last digit of the frames and
+// of the ID.
+class TimecodeBurnIn {
+public:
+	static constexpr int TEXT_LENGTH = 23; // with a leading space
+
+	TimecodeBurnIn();
+
+	// Rasterize the atlas in white and black (packed colors, see
+	// PatternRenderer.h) for frames of layout at frame_rate_N/D, and place
+	// the text in the top-right corner, or the bottom-right one when top
+	// is false. buffers is the number of frame buffers drawn into.
+	// Returns false if the frame is too small for the text.
+	bool init(const FrameLayout &layout, int frame_rate_N,
+		  int frame_rate_D, uint32_t white, uint32_t black, bool top,
+		  int buffers);
+
+	// Draw the text of the frame at frame_ns with frame ID id into
+	// p_data, the frame of buffer slot
+	void draw(int slot, uint8_t *p_data, uint64_t frame_ns, uint32_t id);
+
+	// Something else was drawn over the text in buffer slot
+	void invalidate(int slot);
+	bool intersects(int x, int y, int w, int h) const;
+
+	// The text draw() shows, leading space included
+	static void format(uint64_t frame_ns, int frame_rate_N,
+			   int frame_rate_D, uint32_t id,
+			   char (&text)[TEXT_LENGTH + 1]);
+
+private:
+	FrameLayout layout_;
+	FrameLayout atlas_layout_; // one column of glyph cells
+	std::vector<uint8_t> atlas_;
+	int frame_rate_N_;
+	int frame_rate_D_;
+	int cell_w_;
+	int cell_h_;
+	int x_;
+	int y_;
+	// Characters in each buffer, 0 where unknown
+	std::vector<std::vector<char>> drawn_;
+};
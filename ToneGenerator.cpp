@@ -0,0 +1,56 @@
+#include "ToneGenerator.h"
+#include <cmath>
+#include <cstring>
+
+static int gcd_int(int a, int b)
+{
+	while (b != 0) {
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+ToneGenerator::ToneGenerator(int frequency, int sample_rate) : phase_(0)
+{
+	// The shortest table that ends exactly on a period boundary holds
+	// frequency / g periods in sample_rate / g samples
+	const int g = gcd_int(frequency, sample_rate);
+	const int size = sample_rate / g;
+	const double pi = 3.14159265358979323846;
+
+	table_.resize(size);
+	for (int i = 0; i < size; ++i) {
+		// Index math in integers so every period is the same samples
+		const double cycles = (double)(((int64_t)i * frequency) %
+					       sample_rate) /
+				      sample_rate;
+		float sample = (float)sin(2.0 * pi * cycles);
+		// Keep the tone non-zero so the start of sound is detectable
+		if (sample == 0.0f)
+			sample = 1.0E-10f;
+		table_[i] = sample;
+	}
+}
+
+void ToneGenerator::fill(float *dst, int no_samples)
+{
+	const int size = (int)table_.size();
+	while (no_samples > 0) {
+		int run = size - phase_;
+		if (run > no_samples)
+			run = no_samples;
+		memcpy(dst, &table_[phase_], run * sizeof(float));
+		dst += run;
+		no_samples -= run;
+		phase_ += run;
+		if (phase_ == size)
+			phase_ = 0;
+	}
+}
+
+void ToneGenerator::advance(int no_samples)
+{
+	phase_ = (int)((phase_ + (int64_t)no_samples) % (int64_t)table_.size());
+}
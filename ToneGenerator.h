@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Sine tone played back from a precomputed table holding a whole number of
+// periods. The phase is an integer index into that table, so the tone stays
+// sample exact however long it runs: 400 Hz at 48 kHz is one 120 sample
+// period, replayed with plain block copies instead of a sinf per sample.
+class ToneGenerator {
+public:
+	ToneGenerator(int frequency, int sample_rate);
+
+	// Restart the tone at phase 0
+	void reset() { phase_ = 0; }
+
+	// Write the next no_samples samples of the tone to dst
+	void fill(float *dst, int no_samples);
+	// Advance the phase as if no_samples had been written
+	void advance(int no_samples);
+
+	// Samples in the table (one or more whole periods)
+	int table_size() const { return (int)table_.size(); }
+
+private:
+	std::vector<float> table_;
+	int phase_; // index of the next sample in table_
+};